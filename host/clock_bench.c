@@ -0,0 +1,283 @@
+/* Host benchmark of the latency-sensitive clock paths
+ *
+ * - button event: clock_input() followed by clock_update(), as done for every press
+ * - display update: disp_update() with the active clock counting down
+ * - tenths update: disp_update() at every tenth of a second under low time, with the renderer's
+ *   extrapolation of the active clock
+ * - indicator update: disp_update() with the active player switching
+ * - input sample: one debounce tick of all buttons, with bouncing presses
+ * - latency record: one tracepoint added to a latency histogram
+ * - timebase correct: raw to calibrated timestamp
+ * - wav: WAV (bits/channels/rate) to 16-bit mono 22050 Hz conversion of one audio DMA buffer
+ *
+ * Prints min/avg/p99/max in nanoseconds per event and the number of LVGL invalidations. Only
+ * timing is measured here, correctness is checked by the ctest tests and clock_replay.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "clock.h"
+#include "debounce.h"
+#include "disp.h"
+#include "latency.h"
+#include "lvgl.h"
+#include "timebase.h"
+#include "wav_reader.h"
+
+#define BUTTON_EVENTS   (200000)
+#define DISPLAY_UPDATES (20000)
+#define INPUT_SAMPLES   (200000)
+#define INPUT_BUTTONS   (6)
+#define AUDIO_BUFFERS   (20000)
+#define AUDIO_FRAMES    (160)       // Frames per audio DMA buffer, see audio.c
+#define AUDIO_RATE      (22050)
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Deterministic pseudo random generator, so runs are comparable */
+static uint32_t rnd_state = 12345;
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1664525 + 1013904223;
+    return rnd_state >> 8;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, int64_t *samples, int n, uint32_t invalidations)
+{
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    qsort(samples, n, sizeof(int64_t), cmp_i64);
+    printf("%-18s %8d %8lld %8lld %8lld %8lld %10.2f\n", name, n,
+           (long long)samples[0], (long long)(sum / n), (long long)samples[n * 99 / 100],
+           (long long)samples[n - 1], (double)invalidations / n);
+}
+
+static void bench_buttons(int64_t *samples)
+{
+    static const enum ClockInputs inputs[] = {
+        InputP1Done, InputP2Done, InputP1Done, InputP2Done, InputP1Done, InputP2Done,
+        InputTimeUp, InputTimeDown, InputPause, InputReset,
+    };
+    chess_clock_t clk;
+    clock_init(&clk, 60 * 1000, 10 * 1000);
+
+    int64_t t_us = 0;
+    for (int i = 0; i < BUTTON_EVENTS; i++) {
+        t_us += rnd() % 3000000;
+        enum ClockInputs input = inputs[rnd() % (sizeof(inputs) / sizeof(inputs[0]))];
+
+        int64_t start = now_ns();
+        clock_input(&clk, input, t_us);
+        clock_update(&clk, t_us);
+        samples[i] = now_ns() - start;
+    }
+    report("button event", samples, BUTTON_EVENTS, 0);
+}
+
+static void bench_display(int64_t *samples)
+{
+    clock_view_t view = {
+        .state = Playing,
+        .active_player = Player1,
+        .set_time_ms = 600 * 1000,
+        .remaining_ms = { 600 * 1000, 300 * 1000 },
+    };
+    disp_update(&view);
+
+    /* Active clock counting down, one update per displayed second */
+    uint32_t inv = lv_stub_stats.invalidations;
+    for (int i = 0; i < DISPLAY_UPDATES; i++) {
+        view.remaining_ms[Player1] = (600 - (i % 600)) * 1000;
+        int64_t start = now_ns();
+        disp_update(&view);
+        samples[i] = now_ns() - start;
+    }
+    report("display update", samples, DISPLAY_UPDATES, lv_stub_stats.invalidations - inv);
+
+    /* Low time: renderer wakes up at each tenth and extrapolates the last 1 Hz snapshot */
+    clock_view_t snapshot = view;
+    inv = lv_stub_stats.invalidations;
+    for (int i = 0; i < DISPLAY_UPDATES; i++) {
+        int64_t t_us = (int64_t)(i % 100) * 100000;
+        if (t_us % 1000000 == 0) {
+            snapshot.remaining_ms[Player1] = CLOCK_TENTHS_BELOW_MS - (uint32_t)(t_us / 1000);
+            snapshot.time_us = t_us;
+        }
+        int64_t start = now_ns();
+        view = snapshot;
+        view.remaining_ms[Player1] = clock_view_remaining_ms(&snapshot, t_us);
+        disp_update(&view);
+        samples[i] = now_ns() - start;
+    }
+    report("tenths update", samples, DISPLAY_UPDATES, lv_stub_stats.invalidations - inv);
+
+    /* Moves: active player changes */
+    inv = lv_stub_stats.invalidations;
+    for (int i = 0; i < DISPLAY_UPDATES; i++) {
+        view.active_player = (i & 1) ? Player1 : Player2;
+        int64_t start = now_ns();
+        disp_update(&view);
+        samples[i] = now_ns() - start;
+    }
+    report("indicator update", samples, DISPLAY_UPDATES, lv_stub_stats.invalidations - inv);
+}
+
+static void bench_input(int64_t *samples)
+{
+    debounce_t db[INPUT_BUTTONS];
+    bool level[INPUT_BUTTONS] = {0};
+    int64_t edge_us[INPUT_BUTTONS] = {0};
+    for (int b = 0; b < INPUT_BUTTONS; b++) {
+        debounce_init(&db[b]);
+    }
+
+    /* 1 ms sampling, a button changes level every 200 ms on average and bounces for 5 ms after */
+    for (int i = 0; i < INPUT_SAMPLES; i++) {
+        int64_t t_us = (int64_t)i * 1000;
+        bool sampled[INPUT_BUTTONS];
+        for (int b = 0; b < INPUT_BUTTONS; b++) {
+            if (rnd() % 200 == 0) {
+                level[b] = !level[b];
+                edge_us[b] = t_us;
+            }
+            sampled[b] = (t_us - edge_us[b] < 5000) ? rnd() & 1 : level[b];
+        }
+
+        int64_t start = now_ns();
+        for (int b = 0; b < INPUT_BUTTONS; b++) {
+            int64_t press_us;
+            debounce_sample(&db[b], sampled[b], t_us, &press_us);
+        }
+        samples[i] = now_ns() - start;
+    }
+    report("input sample", samples, INPUT_SAMPLES, 0);
+}
+
+static void bench_latency(int64_t *samples)
+{
+    latency_reset();
+    for (int i = 0; i < BUTTON_EVENTS; i++) {
+        int64_t press_us = 1000000 + i;
+        int64_t delay_us = 1000 + rnd() % 30000;
+        int64_t start = now_ns();
+        latency_record(LatencyDisplay, press_us, press_us + delay_us);
+        samples[i] = now_ns() - start;
+    }
+    report("latency record", samples, BUTTON_EVENTS, 0);
+
+    latency_summary_t sum;
+    latency_get(LatencyDisplay, &sum);
+    printf("  %u delays 1..31 ms: min %u p50 %u p99 %u max %u us\n", (unsigned)sum.count,
+           (unsigned)sum.min_us, (unsigned)sum.p50_us, (unsigned)sum.p99_us, (unsigned)sum.max_us);
+}
+
+static volatile int64_t timebase_sink;     // Keeps the conversion from being optimized out
+
+static void bench_timebase(int64_t *samples)
+{
+    timebase_t tb;
+    timebase_init(&tb, 0, 0);
+    timebase_set_ppb(&tb, 1000000, -23456);
+    for (int i = 0; i < BUTTON_EVENTS; i++) {
+        int64_t raw_us = 1000000 + (int64_t)i * 36000;     // Up to 2 h
+        int64_t start = now_ns();
+        timebase_sink = timebase_correct(&tb, raw_us);
+        samples[i] = now_ns() - start;
+    }
+    report("timebase correct", samples, BUTTON_EVENTS, 0);
+}
+
+/* Build WAV file with a sawtooth (PCM) or pseudo random data (IMA-ADPCM, bits == 4) in memory */
+static uint8_t *make_wav(uint16_t channels, uint16_t bits, uint32_t rate, uint32_t frames, size_t *size)
+{
+    uint16_t block_align = (bits == 4) ? 256 * channels : channels * bits / 8;
+    uint32_t data_size = (bits == 4) ? frames / 2 * channels : frames * block_align;
+    *size = 44 + data_size;
+    uint8_t *wav = malloc(*size);
+    assert(wav);
+
+    uint32_t riff_size = 36 + data_size;
+    uint32_t byte_rate = rate * block_align;
+    uint16_t pcm = (bits == 4) ? WAVE_FORMAT_IMA_ADPCM : WAVE_FORMAT_PCM;
+    uint32_t fmt_size = 16;
+    memcpy(wav, "RIFF", 4);
+    memcpy(wav + 4, &riff_size, 4);
+    memcpy(wav + 8, "WAVEfmt ", 8);
+    memcpy(wav + 16, &fmt_size, 4);
+    memcpy(wav + 20, &pcm, 2);
+    memcpy(wav + 22, &channels, 2);
+    memcpy(wav + 24, &rate, 4);
+    memcpy(wav + 28, &byte_rate, 4);
+    memcpy(wav + 32, &block_align, 2);
+    memcpy(wav + 34, &bits, 2);
+    memcpy(wav + 36, "data", 4);
+    memcpy(wav + 40, &data_size, 4);
+    for (uint32_t i = 0; i < data_size; i++) {
+        wav[44 + i] = (uint8_t)(i * 7);
+    }
+    return wav;
+}
+
+static void bench_wav(int64_t *samples, const char *name, uint16_t channels, uint16_t bits, uint32_t rate)
+{
+    size_t size;
+    uint8_t *wav = make_wav(channels, bits, rate, rate, &size);
+    wav_reader_t reader;
+    if (wav_reader_open(&reader, wav, size, AUDIO_RATE) != ESP_OK) {
+        printf("%-18s open failed\n", name);
+        free(wav);
+        return;
+    }
+
+    int16_t out[AUDIO_FRAMES];
+    for (int i = 0; i < AUDIO_BUFFERS; i++) {
+        int64_t start = now_ns();
+        if (wav_reader_read(&reader, out, AUDIO_FRAMES) < AUDIO_FRAMES) {
+            wav_reader_rewind(&reader);
+        }
+        samples[i] = now_ns() - start;
+    }
+    report(name, samples, AUDIO_BUFFERS, 0);
+    free(wav);
+}
+
+int main(void)
+{
+    int64_t *samples = malloc(sizeof(int64_t) * BUTTON_EVENTS);
+    if (samples == NULL) {
+        return 1;
+    }
+
+    disp_init();
+
+    printf("%-18s %8s %8s %8s %8s %8s %10s\n", "[ns]", "n", "min", "avg", "p99", "max", "inval/ev");
+    bench_buttons(samples);
+    bench_display(samples);
+    bench_input(samples);
+    bench_latency(samples);
+    bench_timebase(samples);
+    bench_wav(samples, "wav 16/1/22050", 1, 16, 22050);
+    bench_wav(samples, "wav 16/2/44100", 2, 16, 44100);
+    bench_wav(samples, "wav 24/2/48000", 2, 24, 48000);
+    bench_wav(samples, "wav 8/1/8000", 1, 8, 8000);
+    bench_wav(samples, "wav adpcm/1/22050", 1, 4, 22050);
+    bench_wav(samples, "wav adpcm/2/44100", 2, 4, 44100);
+
+    free(samples);
+    return 0;
+}
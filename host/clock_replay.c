@@ -0,0 +1,512 @@
+/* Deterministic trace replay and fuzzing of the clock core
+ *
+ * Every virtual clock is driven the way clock_loop() drives the real one: clock_update() at
+ * each clock_next_deadline_us() and clock_input() for each button press, with virtual
+ * timestamps. A press may be handled late, after a tick past its timestamp, as when it waits
+ * in the input ring. After every step the clock is checked against a ledger kept here:
+ *
+ * - remaining times never wrap below zero, the flag falls at zero and only there
+ * - each player is charged exactly the time their clock ran, less delay, plus increments and
+ *   period time (1 ms tolerance per late press, which is rounded separately)
+ * - a tick at the deadline changes the displayed time, the starting time never reaches zero
+ * - a move or pause made before the flag fell but handled after it still counts, no input
+ *   resets the game within CLOCK_FLAG_HOLD_US of the flag
+ *
+ *   clock_replay [-j threads] [-n clocks] [-e events] [-s seed]    random traces
+ *   clock_replay [-v] -r file                                      replay one trace
+ *
+ * Random traces are derived from the seed and the clock index only, so a run is reproducible
+ * on any number of threads. A clock that breaks an invariant writes its trace to
+ * fail_<clock>.trace. Trace lines are "<time_us> <lag_us> <input>", input one of
+ * p1 p2 up down pause reset.
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock.h"
+
+#define DEFAULT_CLOCKS      (4096)
+#define DEFAULT_EVENTS      (2000)      // Presses per clock
+#define DEFAULT_SEED        (12345)
+
+typedef struct {
+    int64_t time_us;            // Press timestamp
+    int32_t lag_us;             // Delay until the press is handled
+    uint8_t input;              // enum ClockInputs
+} trace_event_t;
+
+typedef struct {
+    chess_clock_t clk;
+    int64_t now_us;             // Last clock_update()
+    int64_t expected_ms[2];     // Ledger as of the end of the last closed turn segment
+    uint32_t tolerance_ms[2];
+    int64_t seg_start_us;       // Start of the running segment of the active player
+    int64_t charged_us;         // Last tick within the running segment
+    uint32_t delay_budget_ms;   // Delay of the current turn not used yet
+    int64_t flag_ledger_ms;     // Ledger of the flagged player before the flag fell
+    const char *error;          // First invariant broken
+    uint32_t error_event;
+    uint64_t inputs;
+    uint64_t updates;
+} vclock_t;
+
+static const char *input_names[] = {
+    [InputP1Done] = "p1",
+    [InputP2Done] = "p2",
+    [InputTimeUp] = "up",
+    [InputTimeDown] = "down",
+    [InputPause] = "pause",
+    [InputReset] = "reset",
+};
+#define INPUT_NUM   (sizeof(input_names) / sizeof(input_names[0]))
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* xorshift64*, one generator per clock */
+static uint32_t rnd(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (uint32_t)((*state * 2685821657736338717ULL) >> 32);
+}
+
+static uint32_t rnd_range(uint64_t *state, uint32_t lo, uint32_t hi)
+{
+    return lo + rnd(state) % (hi - lo + 1);
+}
+
+static void fail(vclock_t *v, const char *error)
+{
+    if (v->error == NULL) {
+        v->error = error;
+    }
+}
+
+static void ledger_reset(vclock_t *v)
+{
+    for (int p = Player1; p <= Player2; p++) {
+        v->expected_ms[p] = v->clk.remaining_ms[p];
+        v->tolerance_ms[p] = 0;
+    }
+}
+
+/* Time the active player has been charged in the running segment as of now_us */
+static int64_t segment_charged_ms(const vclock_t *v, int64_t now_us)
+{
+    int64_t ms = (now_us > v->seg_start_us) ? (now_us - v->seg_start_us) / 1000 : 0;
+    return (ms > v->delay_budget_ms) ? ms - v->delay_budget_ms : 0;
+}
+
+/* Active player's segment ended at end_us, clock_charge() rounds it to nearest */
+static void segment_close(vclock_t *v, enum Players player, int64_t end_us, bool late)
+{
+    int64_t us = end_us - v->seg_start_us;
+    int64_t ms = (us > 0) ? (us + 500) / 1000 : 0;
+    int64_t delay_ms = (ms < v->delay_budget_ms) ? ms : v->delay_budget_ms;
+    v->delay_budget_ms -= delay_ms;
+    v->expected_ms[player] -= ms - delay_ms;
+    if (v->expected_ms[player] < 0) {
+        v->expected_ms[player] = 0;
+    }
+    if (late) {
+        v->tolerance_ms[player]++;
+    }
+}
+
+static void check(vclock_t *v)
+{
+    const chess_clock_t *clk = &v->clk;
+
+    if (clk->set_time_ms == 0 || clk->set_time_ms >= (1u << 31)) {
+        fail(v, "starting time out of range");
+    }
+    for (int p = Player1; p <= Player2; p++) {
+        if (clk->remaining_ms[p] >= (1u << 31)) {
+            fail(v, "remaining time wrapped below zero");
+        }
+    }
+    if (clk->state == Timeout && clk->remaining_ms[clk->active_player] != 0) {
+        fail(v, "flag fell with time left");
+    }
+    if (clk->state == Playing && clk->remaining_ms[clk->active_player] == 0) {
+        fail(v, "clock running at zero");
+    }
+
+    for (int p = Player1; p <= Player2; p++) {
+        int64_t expected = v->expected_ms[p];
+        if (clk->state == Playing && clk->active_player == (enum Players)p) {
+            expected -= segment_charged_ms(v, v->charged_us);
+            expected = (expected < 0) ? 0 : expected;
+        }
+        int64_t diff = (int64_t)clk->remaining_ms[p] - expected;
+        if (diff > v->tolerance_ms[p] || -diff > v->tolerance_ms[p]) {
+            fail(v, "time not conserved");
+        }
+    }
+}
+
+/* Clock tick at now_us, as clock_loop() does on its timeout */
+static uint32_t step_update(vclock_t *v, int64_t now_us)
+{
+    const chess_clock_t prev = v->clk;
+    uint32_t changes = clock_update(&v->clk, now_us);
+    v->now_us = now_us;
+    v->charged_us = now_us;
+    v->updates++;
+
+    if (prev.state == Playing && v->clk.state == Timeout) {
+        enum Players a = prev.active_player;
+        if (v->expected_ms[a] - segment_charged_ms(v, now_us) > v->tolerance_ms[a]) {
+            fail(v, "flag fell early");
+        }
+        v->flag_ledger_ms = v->expected_ms[a];
+        v->expected_ms[a] = 0;
+    }
+    check(v);
+    return changes;
+}
+
+static void step_input(vclock_t *v, enum ClockInputs input, int64_t time_us)
+{
+    const chess_clock_t prev = v->clk;
+    uint32_t changes = clock_input(&v->clk, input, time_us);
+    const chess_clock_t *clk = &v->clk;
+    v->inputs++;
+
+    if (prev.state == Timeout && clk->state != Timeout && time_us < prev.flag_us + CLOCK_FLAG_HOLD_US &&
+        (clk->state == Setup || time_us > prev.flag_us - 500)) {
+        fail(v, "press racing the flag changed the game");
+    }
+    if (clk->state == Setup) {
+        ledger_reset(v);
+        check(v);
+        return;
+    }
+
+    enum Players a = prev.active_player;
+    if (prev.state == Timeout && clk->state != Timeout) {
+        /* Move or pause made before the flag fell, the turn ends at its own time */
+        v->expected_ms[a] = v->flag_ledger_ms;
+        segment_close(v, a, time_us, true);
+    }
+    bool segment_ended = prev.state == Playing &&
+                         (clk->state != Playing || clk->active_player != a || clk->moves != prev.moves);
+    if (segment_ended) {
+        segment_close(v, a, time_us, time_us < prev.mark_us);
+    }
+    if (clk->moves != prev.moves) {
+        const tc_period_t *period = &time_controls[prev.control].periods[prev.period[a]];
+        if (clk->last_bonus_ms > period->bonus_ms || (changes & CLOCK_MOVE) == 0) {
+            fail(v, "bad move bonus");
+        }
+        v->expected_ms[a] += clk->last_bonus_ms;
+        if (clk->period[a] != prev.period[a]) {
+            v->expected_ms[a] += time_controls[clk->control].periods[clk->period[a]].time_ms;
+        }
+    }
+    if (clk->state == Timeout) {
+        v->expected_ms[clk->active_player] = 0;
+    }
+
+    bool segment_started = clk->state == Playing &&
+                           (prev.state != Playing || clk->active_player != a || clk->moves != prev.moves);
+    if (segment_started) {
+        /* Resuming the paused player continues their turn and its delay */
+        if (prev.state != Pause || prev.active_player != clk->active_player) {
+            const tc_period_t *period = &time_controls[clk->control].periods[clk->period[clk->active_player]];
+            v->delay_budget_ms = (period->bonus == BonusDelay) ? period->bonus_ms : 0;
+        }
+        v->seg_start_us = time_us;
+        v->charged_us = time_us;
+    }
+    check(v);
+}
+
+static void vclock_init(vclock_t *v)
+{
+    memset(v, 0, sizeof(*v));
+    clock_init(&v->clk, 60 * 1000, 10 * 1000);
+    ledger_reset(v);
+}
+
+/* Ticks up to the moment the press is handled, the press at its own time, then the tick
+   that follows the input notification */
+static void vclock_run(vclock_t *v, const trace_event_t *e, uint32_t index)
+{
+    /* Presses are handled in order, one may be pressed while the previous one waits */
+    int64_t handled_us = e->time_us + e->lag_us;
+    handled_us = (handled_us > v->now_us) ? handled_us : v->now_us;
+    while (v->error == NULL) {
+        int64_t deadline = clock_next_deadline_us(&v->clk, v->now_us);
+        if (deadline > handled_us) {
+            break;
+        }
+        uint32_t changes = step_update(v, deadline);
+        if ((changes & (CLOCK_CHANGED_TIME | CLOCK_TIMEOUT)) == 0) {
+            fail(v, "tick at deadline changed nothing");
+        }
+        if (clock_next_deadline_us(&v->clk, deadline) <= deadline) {
+            fail(v, "deadline did not advance");
+        }
+    }
+    if (e->input < INPUT_NUM) {
+        step_input(v, e->input, e->time_us);
+    }
+    if (handled_us > v->now_us) {
+        step_update(v, handled_us);
+    }
+    if (v->error != NULL && v->error_event == 0) {
+        v->error_event = index + 1;
+    }
+}
+
+/* Press sequence that keeps visiting odd corners: rapid alternation, presses right after the
+   flag fell, '-' down to the step size, presses handled after a tick */
+static void trace_generate(trace_event_t *trace, uint32_t n, uint64_t seed)
+{
+    uint64_t rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+    int64_t t_us = 1000000;
+    enum Players turn = Player1;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t r = rnd_range(&rng, 0, 99);
+        if (r < 10) {
+            t_us += rnd_range(&rng, 0, 3000);                   // Bounce-like burst
+        }
+        else if (r < 20) {
+            t_us += rnd_range(&rng, 3000, 50000);
+        }
+        else if (r < 60) {
+            t_us += rnd_range(&rng, 50000, 3000000);
+        }
+        else if (r < 90) {
+            t_us += rnd_range(&rng, 3000000, 30000000);
+        }
+        else {
+            t_us += rnd_range(&rng, 30000000, 300000000);       // Long enough for a flag fall
+        }
+
+        r = rnd_range(&rng, 0, 99);
+        enum ClockInputs input;
+        if (r < 70) {
+            /* Mostly the player to move, sometimes the wrong button */
+            enum Players p = (rnd_range(&rng, 0, 9) < 8) ? turn : !turn;
+            input = (p == Player1) ? InputP1Done : InputP2Done;
+            turn = !p;
+        }
+        else if (r < 78) {
+            input = InputPause;
+        }
+        else if (r < 84) {
+            input = InputTimeUp;
+        }
+        else if (r < 92) {
+            input = InputTimeDown;
+        }
+        else {
+            input = InputReset;
+        }
+
+        trace[i].time_us = t_us;
+        trace[i].lag_us = (rnd_range(&rng, 0, 9) < 8) ? rnd_range(&rng, 0, 2000) : rnd_range(&rng, 2000, 50000);
+        trace[i].input = input;
+    }
+}
+
+static int trace_write(const char *path, const trace_event_t *trace, uint32_t n)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        fprintf(f, "%" PRId64 " %d %s\n", trace[i].time_us, (int)trace[i].lag_us, input_names[trace[i].input]);
+    }
+    fclose(f);
+    return 0;
+}
+
+static trace_event_t *trace_read(const char *path, uint32_t *n)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    uint32_t cap = 1024;
+    trace_event_t *trace = malloc(cap * sizeof(trace_event_t));
+    char line[128];
+    *n = 0;
+    while (trace && fgets(line, sizeof(line), f)) {
+        int64_t time_us;
+        int lag_us;
+        char name[16];
+        if (line[0] == '#' || sscanf(line, "%" SCNd64 " %d %15s", &time_us, &lag_us, name) != 3) {
+            continue;
+        }
+        unsigned int input = 0;
+        while (input < INPUT_NUM && strcmp(name, input_names[input]) != 0) {
+            input++;
+        }
+        if (input == INPUT_NUM) {
+            fprintf(stderr, "%s: unknown input '%s'\n", path, name);
+            continue;
+        }
+        if (*n == cap) {
+            cap *= 2;
+            trace_event_t *grown = realloc(trace, cap * sizeof(trace_event_t));
+            if (grown == NULL) {
+                free(trace);
+                trace = NULL;
+                break;
+            }
+            trace = grown;
+        }
+        trace[*n].time_us = time_us;
+        trace[*n].lag_us = lag_us;
+        trace[*n].input = input;
+        (*n)++;
+    }
+    fclose(f);
+    return trace;
+}
+
+/* Random mode, shared by the workers */
+static struct {
+    uint32_t clocks;
+    uint32_t events;
+    uint64_t seed;
+    atomic_uint next_clock;
+    atomic_uint_fast64_t inputs;
+    atomic_uint_fast64_t updates;
+    atomic_uint failed;
+} fuzz;
+
+static void *fuzz_worker(void *arg)
+{
+    trace_event_t *trace = malloc(fuzz.events * sizeof(trace_event_t));
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    uint32_t c;
+    while ((c = atomic_fetch_add(&fuzz.next_clock, 1)) < fuzz.clocks) {
+        vclock_t v;
+        vclock_init(&v);
+        trace_generate(trace, fuzz.events, fuzz.seed ^ ((uint64_t)c << 32));
+        for (uint32_t i = 0; i < fuzz.events && v.error == NULL; i++) {
+            vclock_run(&v, &trace[i], i);
+        }
+        atomic_fetch_add(&fuzz.inputs, v.inputs);
+        atomic_fetch_add(&fuzz.updates, v.updates);
+
+        if (v.error != NULL) {
+            char path[32];
+            snprintf(path, sizeof(path), "fail_%u.trace", (unsigned)c);
+            trace_write(path, trace, v.error_event);
+            printf("clock %u: %s at press %u, trace in %s\n", (unsigned)c, v.error, (unsigned)v.error_event, path);
+            atomic_fetch_add(&fuzz.failed, 1);
+        }
+    }
+    free(trace);
+    return NULL;
+}
+
+static int replay(const char *path, bool verbose)
+{
+    uint32_t n;
+    trace_event_t *trace = trace_read(path, &n);
+    if (trace == NULL) {
+        fprintf(stderr, "%s: cannot read trace\n", path);
+        return 2;
+    }
+
+    vclock_t v;
+    vclock_init(&v);
+    for (uint32_t i = 0; i < n && v.error == NULL; i++) {
+        vclock_run(&v, &trace[i], i);
+        if (verbose) {
+            printf("%5u %12" PRId64 " %-5s  state %d active %d  %7u %7u ms  expected %7" PRId64 " %7" PRId64 " ms\n",
+                   (unsigned)i + 1, trace[i].time_us, input_names[trace[i].input], v.clk.state, v.clk.active_player,
+                   (unsigned)v.clk.remaining_ms[Player1], (unsigned)v.clk.remaining_ms[Player2],
+                   v.expected_ms[Player1], v.expected_ms[Player2]);
+        }
+    }
+    free(trace);
+
+    if (v.error != NULL) {
+        printf("%s: %s at press %u\n", path, v.error, (unsigned)v.error_event);
+        printf("  state %d, active %d, remaining %u/%u ms, expected %" PRId64 "/%" PRId64 " ms\n",
+               v.clk.state, v.clk.active_player, (unsigned)v.clk.remaining_ms[Player1],
+               (unsigned)v.clk.remaining_ms[Player2], v.expected_ms[Player1], v.expected_ms[Player2]);
+        return 1;
+    }
+    printf("%s: %u presses, %" PRIu64 " ticks, all invariants hold\n", path, (unsigned)n, v.updates);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = (cores > 0) ? (unsigned int)cores : 1;
+    const char *replay_path = NULL;
+    bool verbose = false;
+    fuzz.clocks = DEFAULT_CLOCKS;
+    fuzz.events = DEFAULT_EVENTS;
+    fuzz.seed = DEFAULT_SEED;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:n:e:s:r:v")) != -1) {
+        switch (opt) {
+            case 'j': threads = strtoul(optarg, NULL, 0); break;
+            case 'n': fuzz.clocks = strtoul(optarg, NULL, 0); break;
+            case 'e': fuzz.events = strtoul(optarg, NULL, 0); break;
+            case 's': fuzz.seed = strtoull(optarg, NULL, 0); break;
+            case 'r': replay_path = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-j threads] [-n clocks] [-e events] [-s seed] | [-v] -r trace\n", argv[0]);
+                return 2;
+        }
+    }
+    if (replay_path != NULL) {
+        return replay(replay_path, verbose);
+    }
+    if (threads == 0 || fuzz.events == 0) {
+        return 2;
+    }
+
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    if (workers == NULL) {
+        return 2;
+    }
+    int64_t start = now_ns();
+    for (unsigned int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, fuzz_worker, NULL);
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    double wall_s = (now_ns() - start) / 1e9;
+    free(workers);
+
+    uint64_t inputs = atomic_load(&fuzz.inputs);
+    uint64_t updates = atomic_load(&fuzz.updates);
+    printf("%u clocks x %u presses on %u threads, seed %" PRIu64 "\n", (unsigned)fuzz.clocks,
+           (unsigned)fuzz.events, threads, fuzz.seed);
+    printf("%" PRIu64 " presses, %" PRIu64 " ticks in %.2f s: %.1f M events/s\n", inputs, updates, wall_s,
+           (inputs + updates) / wall_s / 1e6);
+    printf("%u clocks broke an invariant\n", (unsigned)atomic_load(&fuzz.failed));
+    return atomic_load(&fuzz.failed) ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+/* Host test of the button debouncer
+ *
+ * Feeds sampled level sequences (one character per sample, '#' pressed, '.' released) and
+ * checks which presses are reported, with which timestamp and when.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "debounce.h"
+
+#define MAX_PRESSES     (4)
+
+typedef struct {
+    const char *name;
+    int64_t period_us;          // Sampling period
+    const char *levels;
+    int presses;
+    int64_t press_us[MAX_PRESSES];      // Reported timestamps
+    int64_t confirm_us[MAX_PRESSES];    // Sample at which each press is reported
+} debounce_case_t;
+
+/* Sample i is taken at i * period_us */
+static const debounce_case_t cases[] = {
+    {
+        "clean press", 1000,
+        "....##############################....",
+        1, { 4000 }, { 24000 },
+    },
+    {
+        "bouncing press keeps first edge", 1000,
+        "...##.#..#.##########################.",
+        1, { 3000 }, { 31000 },
+    },
+    {
+        "bounce longer than the window is a new press", 1000,
+        "..##.....................##########################",
+        1, { 25000 }, { 45000 },
+    },
+    {
+        "glitch shorter than the window", 1000,
+        "..###.........................................",
+        0, { 0 }, { 0 },
+    },
+    {
+        "bouncing release is one press", 1000,
+        "..######################.#.#.##.#..........................",
+        1, { 2000 }, { 22000 },
+    },
+    {
+        "two presses", 1000,
+        "..#.######################.........................#.##########################",
+        2, { 2000, 51000 }, { 24000, 73000 },
+    },
+    {
+        "idle sampling", 10000,
+        ".#.####.....",
+        1, { 10000 }, { 50000 },
+    },
+};
+
+static int run_case(const debounce_case_t *c)
+{
+    debounce_t db;
+    debounce_init(&db);
+    int found = 0;
+    int errors = 0;
+    size_t n = strlen(c->levels);
+
+    for (size_t i = 0; i < n; i++) {
+        int64_t now_us = (int64_t)i * c->period_us;
+        int64_t press_us = -1;
+        if (!debounce_sample(&db, c->levels[i] == '#', now_us, &press_us)) {
+            continue;
+        }
+        if (found >= c->presses) {
+            printf("FAIL %s: unexpected press %lld us at %lld us\n", c->name, (long long)press_us, (long long)now_us);
+            errors++;
+        }
+        else if (press_us != c->press_us[found] || now_us != c->confirm_us[found]) {
+            printf("FAIL %s: press %d at %lld us reported at %lld us, expected %lld us at %lld us\n", c->name,
+                   found, (long long)press_us, (long long)now_us, (long long)c->press_us[found],
+                   (long long)c->confirm_us[found]);
+            errors++;
+        }
+        found++;
+    }
+    if (found < c->presses) {
+        printf("FAIL %s: %d presses, expected %d\n", c->name, found, c->presses);
+        errors++;
+    }
+    return errors;
+}
+
+int main(void)
+{
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        errors += run_case(&cases[i]);
+    }
+    printf("%d debounce cases, %d failures\n", (int)(sizeof(cases) / sizeof(cases[0])), errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+/* Host stand-in for the esp32_s2_kaluga_kit BSP, only what the clock core uses */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+typedef enum {
+    BSP_BUTTON_REC = 0,
+    BSP_BUTTON_MODE,
+    BSP_BUTTON_PLAY,
+    BSP_BUTTON_SET,
+    BSP_BUTTON_VOLDOWN,
+    BSP_BUTTON_VOLUP,
+    BSP_BUTTON_NUM
+} bsp_button_t;
+
+bool bsp_display_lock(uint32_t timeout_ms);
+void bsp_display_unlock(void);
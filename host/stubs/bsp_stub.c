@@ -0,0 +1,27 @@
+#include <pthread.h>
+#include "bsp/esp-bsp.h"
+
+/* LVGL mutex, recursive like the one in esp_lvgl_port */
+static pthread_mutex_t lvgl_mux;
+static pthread_once_t lvgl_mux_once = PTHREAD_ONCE_INIT;
+
+static void lvgl_mux_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&lvgl_mux, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+bool bsp_display_lock(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    pthread_once(&lvgl_mux_once, lvgl_mux_init);
+    return pthread_mutex_lock(&lvgl_mux) == 0;
+}
+
+void bsp_display_unlock(void)
+{
+    pthread_mutex_unlock(&lvgl_mux);
+}
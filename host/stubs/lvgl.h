@@ -0,0 +1,165 @@
+/* Host stand-in for LVGL v8, only the API used by disp.c
+ *
+ * Widgets keep their state so that the work done per call is comparable to the real library,
+ * and every call that would make LVGL redraw or relayout something is counted in lv_stub_stats.
+ */
+#pragma once
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef int16_t lv_coord_t;
+typedef uint32_t lv_style_selector_t;
+
+typedef union {
+    uint16_t full;
+} lv_color_t;
+
+typedef uint8_t lv_opa_t;
+#define LV_OPA_TRANSP   0
+#define LV_OPA_COVER    255
+
+typedef struct {
+    uint16_t adv_w;
+    uint16_t box_w;
+    uint16_t box_h;
+    int16_t ofs_x;
+    int16_t ofs_y;
+    uint8_t bpp;
+} lv_font_glyph_dsc_t;
+
+typedef struct _lv_font_t {
+    bool (*get_glyph_dsc)(const struct _lv_font_t *, lv_font_glyph_dsc_t *, uint32_t letter, uint32_t letter_next);
+    const uint8_t *(*get_glyph_bitmap)(const struct _lv_font_t *, uint32_t);
+    lv_coord_t line_height;
+    lv_coord_t base_line;
+} lv_font_t;
+
+enum {
+    LV_IMG_CF_TRUE_COLOR = 4,
+    LV_IMG_CF_ALPHA_8BIT = 14,
+};
+
+typedef struct {
+    uint32_t cf : 5;
+    uint32_t always_zero : 3;
+    uint32_t reserved : 2;
+    uint32_t w : 11;
+    uint32_t h : 11;
+} lv_img_header_t;
+
+typedef struct {
+    lv_img_header_t header;
+    uint32_t data_size;
+    const uint8_t *data;
+} lv_img_dsc_t;
+
+typedef struct {
+    lv_color_t border_color;
+    lv_color_t bg_color;
+    lv_coord_t border_width;
+    lv_coord_t radius;
+    const lv_font_t *text_font;
+} lv_style_t;
+
+typedef struct _lv_obj_t {
+    lv_coord_t x, y, w, h;
+    int32_t min_value;
+    int32_t max_value;
+    int32_t cur_value;
+    char *text;
+    const lv_style_t *styles[4];
+    const void *src;
+    lv_color_t local_border_color;
+} lv_obj_t;
+
+typedef struct {
+    char *txt;
+    bool static_flag;
+    lv_obj_t *spangroup;
+    lv_style_t style;
+} lv_span_t;
+
+typedef enum {
+    LV_PALETTE_RED,
+    LV_PALETTE_BLUE,
+    _LV_PALETTE_LAST
+} lv_palette_t;
+
+enum {
+    LV_ALIGN_TOP_LEFT,
+    LV_ALIGN_TOP_MID,
+    LV_ALIGN_TOP_RIGHT,
+    LV_ALIGN_BOTTOM_LEFT,
+    LV_ALIGN_BOTTOM_MID,
+    LV_ALIGN_BOTTOM_RIGHT,
+    LV_ALIGN_CENTER,
+};
+enum { LV_TEXT_ALIGN_CENTER };
+enum { LV_SPAN_OVERFLOW_CLIP };
+enum { LV_SPAN_MODE_FIXED };
+enum { LV_ANIM_OFF, LV_ANIM_ON };
+#define LV_OBJ_FLAG_SCROLLABLE  (1 << 4)
+#define LV_PART_MAIN        0x000000
+#define LV_PART_INDICATOR   0x020000
+
+/* Counters of operations that make LVGL redraw or relayout */
+typedef struct {
+    uint32_t invalidations;     // Widget areas marked for redraw
+    uint32_t relayouts;         // Spangroup text relayouts
+} lv_stub_stats_t;
+extern lv_stub_stats_t lv_stub_stats;
+
+extern const lv_font_t lv_font_montserrat_24;
+
+lv_coord_t lv_disp_get_hor_res(void *disp);
+lv_coord_t lv_disp_get_ver_res(void *disp);
+lv_obj_t *lv_scr_act(void);
+lv_obj_t *lv_obj_create(lv_obj_t *parent);
+void lv_obj_remove_style_all(lv_obj_t *obj);
+void lv_obj_clear_flag(lv_obj_t *obj, uint32_t f);
+void lv_obj_set_pos(lv_obj_t *obj, lv_coord_t x, lv_coord_t y);
+void lv_obj_set_size(lv_obj_t *obj, lv_coord_t w, lv_coord_t h);
+void lv_obj_align(lv_obj_t *obj, int align, lv_coord_t x_ofs, lv_coord_t y_ofs);
+void lv_obj_add_style(lv_obj_t *obj, lv_style_t *style, lv_style_selector_t selector);
+void lv_obj_invalidate(const lv_obj_t *obj);
+void lv_obj_set_style_border_color(lv_obj_t *obj, lv_color_t value, lv_style_selector_t selector);
+void lv_obj_set_style_img_recolor(lv_obj_t *obj, lv_color_t value, lv_style_selector_t selector);
+void lv_obj_set_style_img_recolor_opa(lv_obj_t *obj, lv_opa_t value, lv_style_selector_t selector);
+
+void lv_style_init(lv_style_t *style);
+void lv_style_set_border_width(lv_style_t *style, lv_coord_t value);
+void lv_style_set_radius(lv_style_t *style, lv_coord_t value);
+void lv_style_set_border_color(lv_style_t *style, lv_color_t value);
+void lv_style_set_bg_color(lv_style_t *style, lv_color_t value);
+void lv_style_set_text_font(lv_style_t *style, const lv_font_t *value);
+
+lv_color_t lv_color_black(void);
+lv_color_t lv_palette_main(lv_palette_t p);
+lv_color_t lv_palette_lighten(lv_palette_t p, uint8_t lvl);
+
+lv_obj_t *lv_spangroup_create(lv_obj_t *par);
+void lv_spangroup_set_align(lv_obj_t *obj, int align);
+void lv_spangroup_set_overflow(lv_obj_t *obj, int overflow);
+void lv_spangroup_set_mode(lv_obj_t *obj, int mode);
+lv_span_t *lv_spangroup_new_span(lv_obj_t *obj);
+void lv_spangroup_refr_mode(lv_obj_t *obj);
+void lv_span_set_text(lv_span_t *span, const char *text);
+void lv_span_set_text_static(lv_span_t *span, const char *text);
+
+lv_obj_t *lv_bar_create(lv_obj_t *parent);
+void lv_bar_set_range(lv_obj_t *obj, int32_t min, int32_t max);
+void lv_bar_set_value(lv_obj_t *obj, int32_t value, int anim);
+
+bool lv_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t letter_next);
+const uint8_t *lv_font_get_glyph_bitmap(const lv_font_t *font, uint32_t letter);
+
+lv_obj_t *lv_img_create(lv_obj_t *parent);
+void lv_img_set_src(lv_obj_t *obj, const void *src);
+
+lv_obj_t *lv_label_create(lv_obj_t *parent);
+void lv_label_set_recolor(lv_obj_t *obj, bool en);
+void lv_label_set_text(lv_obj_t *obj, const char *text);
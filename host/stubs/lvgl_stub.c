@@ -0,0 +1,307 @@
+#include "lvgl.h"
+
+lv_stub_stats_t lv_stub_stats;
+
+/* Montserrat 24 like metrics, every glyph is a filled box */
+static const uint8_t stub_glyph_bitmap[(15 * 17 * 4 + 7) / 8] = { [0 ... (15 * 17 * 4 + 7) / 8 - 1] = 0xF7 };
+
+static bool stub_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t letter_next)
+{
+    (void)font;
+    (void)letter_next;
+    bool digit = (letter >= '0' && letter <= '9');
+    dsc->adv_w = digit ? 17 : 6;
+    dsc->box_w = digit ? 15 : (letter == ' ' ? 0 : 4);
+    dsc->box_h = digit ? 17 : (letter == ' ' ? 0 : 13);
+    dsc->ofs_x = 1;
+    dsc->ofs_y = 0;
+    dsc->bpp = 4;
+    return true;
+}
+
+static const uint8_t *stub_glyph_bitmap_get(const lv_font_t *font, uint32_t letter)
+{
+    (void)font;
+    (void)letter;
+    return stub_glyph_bitmap;
+}
+
+const lv_font_t lv_font_montserrat_24 = {
+    .get_glyph_dsc = stub_glyph_dsc,
+    .get_glyph_bitmap = stub_glyph_bitmap_get,
+    .line_height = 27,
+    .base_line = 5,
+};
+
+static lv_obj_t screen;
+
+static const uint16_t palette_main[_LV_PALETTE_LAST] = { 0xF206, 0x249E };
+
+static lv_obj_t *obj_create(void)
+{
+    lv_obj_t *obj = calloc(1, sizeof(lv_obj_t));
+    assert(obj);
+    return obj;
+}
+
+/* Kaluga LCD in landscape */
+lv_coord_t lv_disp_get_hor_res(void *disp)
+{
+    (void)disp;
+    return 320;
+}
+
+lv_coord_t lv_disp_get_ver_res(void *disp)
+{
+    (void)disp;
+    return 240;
+}
+
+lv_obj_t *lv_scr_act(void)
+{
+    return &screen;
+}
+
+lv_obj_t *lv_obj_create(lv_obj_t *parent)
+{
+    (void)parent;
+    return obj_create();
+}
+
+void lv_obj_remove_style_all(lv_obj_t *obj)
+{
+    memset(obj->styles, 0, sizeof(obj->styles));
+}
+
+void lv_obj_clear_flag(lv_obj_t *obj, uint32_t f)
+{
+    (void)obj;
+    (void)f;
+}
+
+void lv_obj_set_pos(lv_obj_t *obj, lv_coord_t x, lv_coord_t y)
+{
+    obj->x = x;
+    obj->y = y;
+}
+
+void lv_obj_set_size(lv_obj_t *obj, lv_coord_t w, lv_coord_t h)
+{
+    obj->w = w;
+    obj->h = h;
+}
+
+void lv_obj_align(lv_obj_t *obj, int align, lv_coord_t x_ofs, lv_coord_t y_ofs)
+{
+    (void)align;
+    obj->x = x_ofs;
+    obj->y = y_ofs;
+}
+
+void lv_obj_add_style(lv_obj_t *obj, lv_style_t *style, lv_style_selector_t selector)
+{
+    obj->styles[(selector >> 16) & 0x3] = style;
+}
+
+void lv_obj_invalidate(const lv_obj_t *obj)
+{
+    (void)obj;
+    lv_stub_stats.invalidations++;
+}
+
+void lv_obj_set_style_border_color(lv_obj_t *obj, lv_color_t value, lv_style_selector_t selector)
+{
+    (void)selector;
+    obj->local_border_color = value;
+    lv_obj_invalidate(obj);
+}
+
+void lv_obj_set_style_img_recolor(lv_obj_t *obj, lv_color_t value, lv_style_selector_t selector)
+{
+    (void)obj;
+    (void)value;
+    (void)selector;
+}
+
+void lv_obj_set_style_img_recolor_opa(lv_obj_t *obj, lv_opa_t value, lv_style_selector_t selector)
+{
+    (void)obj;
+    (void)value;
+    (void)selector;
+}
+
+void lv_style_init(lv_style_t *style)
+{
+    memset(style, 0, sizeof(lv_style_t));
+}
+
+void lv_style_set_border_width(lv_style_t *style, lv_coord_t value)
+{
+    style->border_width = value;
+}
+
+void lv_style_set_radius(lv_style_t *style, lv_coord_t value)
+{
+    style->radius = value;
+}
+
+void lv_style_set_border_color(lv_style_t *style, lv_color_t value)
+{
+    style->border_color = value;
+}
+
+void lv_style_set_bg_color(lv_style_t *style, lv_color_t value)
+{
+    style->bg_color = value;
+}
+
+void lv_style_set_text_font(lv_style_t *style, const lv_font_t *value)
+{
+    style->text_font = value;
+}
+
+lv_color_t lv_color_black(void)
+{
+    return (lv_color_t){ .full = 0 };
+}
+
+lv_color_t lv_palette_main(lv_palette_t p)
+{
+    return (lv_color_t){ .full = palette_main[p] };
+}
+
+lv_color_t lv_palette_lighten(lv_palette_t p, uint8_t lvl)
+{
+    return (lv_color_t){ .full = palette_main[p] | (0x0821 * lvl) };
+}
+
+lv_obj_t *lv_spangroup_create(lv_obj_t *par)
+{
+    (void)par;
+    return obj_create();
+}
+
+void lv_spangroup_set_align(lv_obj_t *obj, int align)
+{
+    (void)obj;
+    (void)align;
+}
+
+void lv_spangroup_set_overflow(lv_obj_t *obj, int overflow)
+{
+    (void)obj;
+    (void)overflow;
+}
+
+void lv_spangroup_set_mode(lv_obj_t *obj, int mode)
+{
+    (void)obj;
+    (void)mode;
+}
+
+lv_span_t *lv_spangroup_new_span(lv_obj_t *obj)
+{
+    lv_span_t *span = calloc(1, sizeof(lv_span_t));
+    assert(span);
+    span->spangroup = obj;
+    return span;
+}
+
+void lv_spangroup_refr_mode(lv_obj_t *obj)
+{
+    (void)obj;
+    lv_stub_stats.relayouts++;
+    lv_stub_stats.invalidations++;
+}
+
+void lv_span_set_text(lv_span_t *span, const char *text)
+{
+    if (!span->static_flag) {
+        free(span->txt);
+    }
+    span->txt = strdup(text);
+    span->static_flag = false;
+    lv_obj_invalidate(span->spangroup);
+}
+
+void lv_span_set_text_static(lv_span_t *span, const char *text)
+{
+    if (!span->static_flag) {
+        free(span->txt);
+    }
+    span->txt = (char *)text;
+    span->static_flag = true;
+    lv_obj_invalidate(span->spangroup);
+}
+
+lv_obj_t *lv_bar_create(lv_obj_t *parent)
+{
+    (void)parent;
+    lv_obj_t *bar = obj_create();
+    bar->max_value = 100;
+    return bar;
+}
+
+void lv_bar_set_range(lv_obj_t *obj, int32_t min, int32_t max)
+{
+    if (obj->min_value == min && obj->max_value == max) {
+        return;
+    }
+    obj->min_value = min;
+    obj->max_value = max;
+    if (obj->cur_value > max) {
+        obj->cur_value = max;
+    }
+    lv_obj_invalidate(obj);
+}
+
+void lv_bar_set_value(lv_obj_t *obj, int32_t value, int anim)
+{
+    (void)anim;
+    if (obj->cur_value == value) {
+        return;
+    }
+    obj->cur_value = value;
+    lv_obj_invalidate(obj);
+}
+
+bool lv_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t letter_next)
+{
+    return font->get_glyph_dsc(font, dsc, letter, letter_next);
+}
+
+const uint8_t *lv_font_get_glyph_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    return font->get_glyph_bitmap(font, letter);
+}
+
+lv_obj_t *lv_img_create(lv_obj_t *parent)
+{
+    (void)parent;
+    return obj_create();
+}
+
+void lv_img_set_src(lv_obj_t *obj, const void *src)
+{
+    obj->src = src;
+    lv_obj_invalidate(obj);
+}
+
+lv_obj_t *lv_label_create(lv_obj_t *parent)
+{
+    (void)parent;
+    return obj_create();
+}
+
+void lv_label_set_recolor(lv_obj_t *obj, bool en)
+{
+    (void)obj;
+    (void)en;
+}
+
+void lv_label_set_text(lv_obj_t *obj, const char *text)
+{
+    free(obj->text);
+    obj->text = strdup(text);
+    lv_obj_invalidate(obj);
+}
@@ -0,0 +1,147 @@
+/* Host test of the time controls
+ *
+ * Plays a number of moves with a fixed time per move under each preset and checks player 1's
+ * remaining time, the bonus of the last move and the period reached. A probe into the next
+ * turn shows whether a delay is consumed before the main time. A case can save the game after
+ * some moves and continue it on a clock restored from the save, as after a reset.
+ * Also checks that selecting a time control in Setup keeps a starting time set with +/-.
+ */
+#include <stdio.h>
+#include "clock.h"
+
+#define OPPONENT_MS     (1000)      // Time player 2 uses for every move
+
+typedef struct {
+    const char *name;
+    unsigned int control;       // Index into time_controls[]
+    int moves;                  // Moves of player 1
+    uint32_t used_ms;           // Time player 1 uses for every move
+    int restore_after;          // Save after this many moves and continue on a restored clock, 0 for none
+    uint32_t remaining_ms;      // Player 1 after the last move
+    uint32_t bonus_ms;          // Bonus of the last move
+    uint8_t period;             // Period of player 1 after the last move
+    uint32_t probe_ms;          // Time into player 1's next turn
+    uint32_t probe_remaining_ms;
+} tc_case_t;
+
+static const tc_case_t cases[] = {
+    { "sudden death", 0, 10, 1000, 0, 50000, 0, 0, 2000, 48000 },
+    { "fischer adds the bonus", 1, 10, 4321, 0, 156790, 2000, 0, 2000, 154790 },
+    { "fischer beyond the starting time", 1, 10, 1000, 0, 190000, 2000, 0, 0, 190000 },
+    { "bronstein refunds the time used", 3, 10, 1234, 0, 300000, 1234, 0, 2000, 298000 },
+    { "bronstein refunds up to the bonus", 3, 10, 4321, 0, 286790, 3000, 0, 2000, 284790 },
+    { "delay before main time", 2, 10, 2500, 0, 300000, 0, 0, 2000, 300000 },
+    { "delay then main time", 2, 10, 4321, 0, 286790, 0, 0, 4000, 285790 },
+    { "40/90 before move 40", 6, 39, 60000, 0, 4230000, 30000, 0, 0, 4230000 },
+    { "40/90 switches at move 40", 6, 40, 60000, 0, 6000000, 30000, 1, 0, 6000000 },
+    { "40/90 after move 40", 6, 41, 60000, 0, 5970000, 30000, 1, 0, 5970000 },
+    { "40/90 restored before move 40", 6, 41, 60000, 39, 5970000, 30000, 1, 0, 5970000 },
+    { "40/90 restored at move 40", 6, 41, 60000, 40, 5970000, 30000, 1, 0, 5970000 },
+    { "40/90 restored after move 40", 6, 50, 60000, 45, 5700000, 30000, 1, 0, 5700000 },
+};
+
+/* Select a time control in Setup, starting from the first one */
+static void select_control(chess_clock_t *clk, unsigned int control)
+{
+    clock_init(clk, 60 * 1000, 10 * 1000);
+    for (unsigned int i = 0; i < control; i++) {
+        clock_input(clk, InputReset, 0);
+    }
+}
+
+static int run_case(const tc_case_t *c)
+{
+    chess_clock_t clk;
+    select_control(&clk, c->control);
+
+    /* Player 2 starts the clock, every turn of player 1 starts at t */
+    int64_t t = 1000000;
+    clock_input(&clk, InputP2Done, t);
+    for (int move = 1; move <= c->moves; move++) {
+        t += c->used_ms * 1000LL;
+        clock_input(&clk, InputP1Done, t);
+        uint32_t bonus = clk.last_bonus_ms;
+        t += OPPONENT_MS * 1000LL;
+        clock_input(&clk, InputP2Done, t);
+
+        if (move == c->restore_after) {
+            clock_view_t saved;
+            clock_get_view(&clk, t, &saved);
+            clock_init(&clk, 60 * 1000, 10 * 1000);
+            clock_restore(&clk, &saved);
+            clock_input(&clk, InputPause, t);
+        }
+        if (move == c->moves) {
+            /* Player 1's next turn has just started */
+            if (clk.state != Playing || clk.active_player != Player1) {
+                printf("FAIL %s: clock not running for player 1\n", c->name);
+                return 1;
+            }
+            uint32_t remaining = clk.remaining_ms[Player1];
+            if (remaining != c->remaining_ms || clk.period[Player1] != c->period) {
+                printf("FAIL %s: %u ms in period %d, expected %u ms in period %d\n", c->name, (unsigned)remaining,
+                       clk.period[Player1], (unsigned)c->remaining_ms, c->period);
+                return 1;
+            }
+            if (bonus != c->bonus_ms) {
+                printf("FAIL %s: bonus %u ms, expected %u ms\n", c->name, (unsigned)bonus, (unsigned)c->bonus_ms);
+                return 1;
+            }
+        }
+    }
+
+    uint32_t probe = clock_remaining_ms(&clk, Player1, t + c->probe_ms * 1000LL);
+    if (probe != c->probe_remaining_ms) {
+        printf("FAIL %s: %u ms after %u ms into the turn, expected %u ms\n", c->name, (unsigned)probe,
+               (unsigned)c->probe_ms, (unsigned)c->probe_remaining_ms);
+        return 1;
+    }
+    return 0;
+}
+
+/* A starting time set with +/- is kept when the time control changes, a preset time is not */
+static int run_setup(void)
+{
+    int errors = 0;
+    chess_clock_t clk;
+
+    select_control(&clk, 1);
+    if (clk.set_time_ms != time_controls[1].periods[0].time_ms) {
+        printf("FAIL setup: preset starting time not loaded\n");
+        errors++;
+    }
+
+    clock_init(&clk, 60 * 1000, 10 * 1000);
+    clock_input(&clk, InputTimeUp, 0);
+    clock_input(&clk, InputReset, 0);
+    clock_input(&clk, InputReset, 0);
+    if (clk.control != 2 || clk.set_time_ms != 70000 || clk.remaining_ms[Player1] != 70000) {
+        printf("FAIL setup: control %d with %u ms, expected control 2 with 70000 ms\n", clk.control,
+               (unsigned)clk.set_time_ms);
+        errors++;
+    }
+
+    /* The adjustment survives a restore */
+    clock_view_t saved;
+    clock_get_view(&clk, 0, &saved);
+    clock_init(&clk, 60 * 1000, 10 * 1000);
+    clock_restore(&clk, &saved);
+    clock_input(&clk, InputReset, 0);
+    if (clk.control != 3 || clk.set_time_ms != 70000) {
+        printf("FAIL setup: restored control %d with %u ms, expected control 3 with 70000 ms\n", clk.control,
+               (unsigned)clk.set_time_ms);
+        errors++;
+    }
+    return errors;
+}
+
+int main(void)
+{
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        errors += run_case(&cases[i]);
+    }
+    errors += run_setup();
+    printf("%d time control cases, %d failures\n", (int)(sizeof(cases) / sizeof(cases[0])) + 1, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+/* Host test of the corrected timebase and the drift estimator
+ *
+ * Feeds simulated 1 PPS edges from a timer with a known rate error, with latency jitter,
+ * missed edges and glitches, and checks the estimate. Also checks that changing the
+ * correction keeps corrected time continuous.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "timebase.h"
+
+typedef struct {
+    const char *name;
+    int32_t error_ppb;          // Rate error of the simulated timer, positive when it runs slow
+    int periods;                // Edges sent
+    int jitter_us;              // Edge latency 0..jitter_us
+    int missed_every;           // Every n-th edge is lost, 0 for none
+    int glitch_every;           // A glitch follows every n-th edge, 0 for none
+    bool valid;                 // An estimate is expected
+    int32_t tolerance_ppb;
+} drift_case_t;
+
+static const drift_case_t cases[] = {
+    { "clean edges", 23456, 600, 0, 0, 0, true, 2 },
+    { "slow timer", -41000, 600, 0, 0, 0, true, 2 },
+    { "jitter, missed edges and glitches", 23456, 600, 20, 97, 131, true, 50 },
+    { "too few periods", 23456, DRIFT_MIN_INTERVALS - 1, 0, 0, 0, false, 0 },
+    { "clamped", 900000, 100, 0, 0, 0, true, 0 },
+};
+
+static uint32_t rnd_state = 12345;
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1664525 + 1013904223;
+    return rnd_state >> 8;
+}
+
+static int run_case(const drift_case_t *c)
+{
+    drift_t d;
+    drift_start(&d, 1000000);
+    for (int i = 0; i <= c->periods; i++) {
+        /* A slow timer counts fewer us per reference second */
+        int64_t raw_us = 5000000 + i * 1000000LL - i * (int64_t)c->error_ppb / 1000 + (c->jitter_us ? rnd() % c->jitter_us : 0);
+        if (c->missed_every == 0 || i % c->missed_every != c->missed_every / 2) {
+            drift_edge(&d, raw_us);
+        }
+        if (c->glitch_every && i % c->glitch_every == 7) {
+            drift_edge(&d, raw_us + 300000);
+        }
+    }
+
+    int32_t ppb = 0;
+    bool valid = drift_ppb(&d, &ppb);
+    int32_t expected = (c->error_ppb > TIMEBASE_PPB_MAX) ? TIMEBASE_PPB_MAX : c->error_ppb;
+    if (valid != c->valid) {
+        printf("FAIL %s: %s estimate\n", c->name, valid ? "unexpected" : "no");
+        return 1;
+    }
+    if (valid && abs(ppb - expected) > c->tolerance_ppb) {
+        printf("FAIL %s: %+d ppb, expected %+d\n", c->name, (int)ppb, (int)expected);
+        return 1;
+    }
+    return 0;
+}
+
+/* Corrected time is continuous across a change of the correction and follows the new rate */
+static int run_continuity(void)
+{
+    timebase_t tb;
+    timebase_init(&tb, 1000, 0);
+    int64_t before = timebase_correct(&tb, 2000000);
+    timebase_set_ppb(&tb, 2000000, 100000);
+    int errors = 0;
+    if (timebase_correct(&tb, 2000000) != before) {
+        printf("FAIL continuity: corrected time jumped\n");
+        errors++;
+    }
+    if (timebase_correct(&tb, 12000000) - before != 10001000) {
+        printf("FAIL continuity: 10 s at +100 ppm is %lld us\n", (long long)(timebase_correct(&tb, 12000000) - before));
+        errors++;
+    }
+    return errors;
+}
+
+int main(void)
+{
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        errors += run_case(&cases[i]);
+    }
+    errors += run_continuity();
+    printf("%d timebase cases, %d failures\n", (int)(sizeof(cases) / sizeof(cases[0])) + 1, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+/* Host test of the WAV reader
+ *
+ * Decodes the clips generated by wav_vectors.py and compares them with the reference samples
+ * from the Python encoder, sample by sample. Each clip is read at its own rate in odd sized
+ * chunks, then rewound and read once more in one go.
+ *
+ * Usage: wav_reader_test <clip.wav> <clip.ref> [<clip.wav> <clip.ref> ...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "wav_reader.h"
+
+#define CHUNK_FRAMES    (37)    // Not a divisor of WAV_BLOCK_FRAMES or of an ADPCM block
+
+static void *load(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void *data = malloc(*size ? *size : 1);
+    if (data != NULL && fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+/* Compare a read with the reference, report the first mismatch */
+static int compare(const char *name, const char *pass, const int16_t *out, size_t n, const int16_t *ref,
+                   size_t ref_n)
+{
+    for (size_t i = 0; i < n && i < ref_n; i++) {
+        if (out[i] != ref[i]) {
+            printf("FAIL %s (%s): sample %zu is %d, expected %d\n", name, pass, i, out[i], ref[i]);
+            return 1;
+        }
+    }
+    if (n != ref_n) {
+        printf("FAIL %s (%s): %zu samples, expected %zu\n", name, pass, n, ref_n);
+        return 1;
+    }
+    return 0;
+}
+
+static int run_clip(const char *wav_path, const char *ref_path)
+{
+    size_t wav_size, ref_size;
+    uint8_t *wav = load(wav_path, &wav_size);
+    int16_t *ref = load(ref_path, &ref_size);
+    if (wav == NULL || ref == NULL) {
+        printf("FAIL %s: cannot read clip or reference\n", wav_path);
+        free(wav);
+        free(ref);
+        return 1;
+    }
+    size_t ref_n = ref_size / sizeof(int16_t);
+
+    int errors = 0;
+    wav_reader_t reader;
+    esp_err_t ret = wav_reader_open(&reader, wav, wav_size, 16000);
+    if (ret != ESP_OK) {
+        printf("FAIL %s: open returned %d\n", wav_path, ret);
+        errors++;
+    }
+    else {
+        /* Room for a chunk past the reference, to catch samples too many */
+        int16_t *out = malloc((ref_n + CHUNK_FRAMES) * sizeof(int16_t));
+        size_t n = 0, got;
+        while (n <= ref_n && (got = wav_reader_read(&reader, out + n, CHUNK_FRAMES)) > 0) {
+            n += got;
+        }
+        errors += compare(wav_path, "chunks", out, n, ref, ref_n);
+
+        wav_reader_rewind(&reader);
+        n = wav_reader_read(&reader, out, ref_n + CHUNK_FRAMES);
+        errors += compare(wav_path, "rewound", out, n, ref, ref_n);
+        free(out);
+    }
+
+    free(wav);
+    free(ref);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc % 2 == 0) {
+        printf("usage: %s <clip.wav> <clip.ref> ...\n", argv[0]);
+        return 2;
+    }
+
+    int errors = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        errors += run_clip(argv[i], argv[i + 1]);
+    }
+    printf("%d clips, %d failures\n", (argc - 1) / 2, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Generate WAV test clips and their reference samples for wav_reader_test.
+
+Every clip <name>.wav comes with <name>.ref, the 16-bit mono samples (little endian) the
+reader must produce at the clip's own rate: the down-mix of tools/adpcm.py for PCM, the
+encoder's own reconstruction for IMA-ADPCM. The signal is a sweep with noise and clipped
+bursts, so the ADPCM step index runs over its whole range.
+
+Usage: wav_vectors.py <output dir>
+"""
+import io
+import math
+import os
+import random
+import struct
+import sys
+import wave
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+import adpcm  # noqa: E402
+
+RATE = 16000
+
+
+def signal(frames, seed):
+    rng = random.Random(seed)
+    out = []
+    for i in range(frames):
+        t = i / RATE
+        s = 12000 * math.sin(2 * math.pi * (200 + 3000 * t) * t) + rng.gauss(0, 800)
+        if (i // 400) % 3 == 2:
+            s *= 4      # Bursts beyond full scale
+        out.append(max(-32768, min(32767, int(s))))
+    return out
+
+
+def pcm_wav(channels, width, frames, seed):
+    chans = [signal(frames, seed + c) for c in range(channels)]
+    raw = bytearray()
+    for i in range(frames):
+        for c in range(channels):
+            s = chans[c][i]
+            if width == 1:
+                raw.append((s >> 8) + 128)
+            elif width == 2:
+                raw += struct.pack('<h', s)
+            else:
+                raw += struct.pack('<i', s << 8 | (i & 0xFF))[:3]   # Low byte is below 16 bits
+    buf = io.BytesIO()
+    with wave.open(buf, 'wb') as w:
+        w.setnchannels(channels)
+        w.setsampwidth(width)
+        w.setframerate(RATE)
+        w.writeframes(bytes(raw))
+    return buf.getvalue()
+
+
+def with_list_chunk(data):
+    """Insert an odd sized chunk before 'fmt ', the reader must skip it and its pad byte."""
+    chunk = b'LIST' + struct.pack('<I', 5) + b'INFOx' + b'\0'
+    body = chunk + data[12:]
+    return b'RIFF' + struct.pack('<I', 4 + len(body)) + b'WAVE' + body
+
+
+def samples(data):
+    return struct.pack('<%dh' % len(data), *data)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    out_dir = sys.argv[1]
+    os.makedirs(out_dir, exist_ok=True)
+
+    clips = {}
+    for name, channels, width, frames in (('pcm8_stereo', 2, 1, 1500),
+                                          ('pcm16_stereo', 2, 2, 2000),
+                                          ('pcm24_mono', 1, 3, 1000)):
+        wav = pcm_wav(channels, width, frames, seed=len(clips))
+        clips[name] = (wav, adpcm.read_pcm_mono(wav)[1])
+    clips['pcm16_list'] = (with_list_chunk(clips['pcm16_stereo'][0]), clips['pcm16_stereo'][1])
+
+    # Whole blocks, and a last block with an odd number of nibbles
+    for name, frames in (('adpcm_blocks', 3 * adpcm.SAMPLES_PER_BLOCK), ('adpcm_tail', 1234)):
+        encoder = adpcm.Encoder()
+        wav = adpcm.encode_wav(pcm_wav(1, 2, frames, seed=len(clips)), encoder)
+        clips[name] = (wav, encoder.decoded)
+
+    for name, (wav, ref) in clips.items():
+        with open(os.path.join(out_dir, name + '.wav'), 'wb') as f:
+            f.write(wav)
+        with open(os.path.join(out_dir, name + '.ref'), 'wb') as f:
+            f.write(samples(ref))
+
+
+if __name__ == '__main__':
+    main()
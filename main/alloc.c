@@ -0,0 +1,51 @@
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "alloc.h"
+
+#if CONFIG_CHESS_STATIC_ALLOC
+static volatile bool armed;
+static TaskHandle_t console_task;
+static heap_guard_stats_t guard;
+
+/* Heap hook (CONFIG_HEAP_USE_HOOKS), called for every successful allocation */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    if (!armed) {
+        return;
+    }
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task == console_task) {
+        return;
+    }
+    guard.allocations++;
+    guard.last_size = size;
+    guard.last_task = task;
+#if CONFIG_CHESS_HEAP_GUARD_ABORT
+    ESP_EARLY_LOGE("alloc", "Heap allocation of %u bytes after init", (unsigned)size);
+    abort();
+#endif
+}
+
+void heap_guard_arm(void)
+{
+    console_task = xTaskGetHandle("console_repl");
+    armed = true;
+}
+
+void heap_guard_get_stats(heap_guard_stats_t *stats)
+{
+    *stats = guard;
+}
+#else
+void heap_guard_arm(void)
+{
+}
+
+void heap_guard_get_stats(heap_guard_stats_t *stats)
+{
+    stats->allocations = 0;
+    stats->last_size = 0;
+    stats->last_task = NULL;
+}
+#endif
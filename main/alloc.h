@@ -0,0 +1,65 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+/**
+ * Allocation policy
+ *
+ * With CONFIG_CHESS_STATIC_ALLOC the application tasks and queues are allocated statically,
+ * buffers are allocated during init only, and heap_guard_arm() at the end of init makes every
+ * later heap allocation visible (or fatal with CONFIG_CHESS_HEAP_GUARD_ABORT). Without it the
+ * macros fall back to the heap and the guard is a no-op.
+ */
+
+#if CONFIG_CHESS_STATIC_ALLOC
+/* Task with a stack and TCB in .bss, one per function */
+#define APP_TASK_CREATE(fn, name, stack_size, arg, prio, handle) do {                           \
+        static StackType_t fn##_stack[stack_size];                                              \
+        static StaticTask_t fn##_tcb;                                                           \
+        TaskHandle_t task_ = xTaskCreateStatic(fn, name, stack_size, arg, prio,                 \
+                                               fn##_stack, &fn##_tcb);                          \
+        assert(task_ != NULL);                                                                  \
+        TaskHandle_t *handle_ = (handle);                                                       \
+        if (handle_ != NULL) {                                                                  \
+            *handle_ = task_;                                                                   \
+        }                                                                                       \
+    } while (0)
+
+/* Queue with storage in .bss, q must be a variable name */
+#define APP_QUEUE_CREATE(q, length, item_size) do {                                             \
+        static uint8_t q##_storage[(length) * (item_size)];                                     \
+        static StaticQueue_t q##_queue;                                                         \
+        q = xQueueCreateStatic(length, item_size, q##_storage, &q##_queue);                     \
+    } while (0)
+#else
+#define APP_TASK_CREATE(fn, name, stack_size, arg, prio, handle) do {                           \
+        BaseType_t ret_ = xTaskCreate(fn, name, stack_size, arg, prio, handle);                 \
+        assert(ret_ == pdPASS);                                                                 \
+    } while (0)
+
+#define APP_QUEUE_CREATE(q, length, item_size) do {                                             \
+        q = xQueueCreate(length, item_size);                                                    \
+    } while (0)
+#endif
+
+typedef struct {
+    uint32_t allocations;       // Heap allocations after heap_guard_arm()
+    uint32_t last_size;         // Size of the last one
+    TaskHandle_t last_task;     // Task that made the last one
+} heap_guard_stats_t;
+
+/**
+ * @brief End of init, flag all heap allocations from now on
+ *
+ * Allocations of the console task are not counted, line editing allocates for every command.
+ */
+void heap_guard_arm(void);
+
+/**
+ * @brief Get heap allocations seen after arming
+ */
+void heap_guard_get_stats(heap_guard_stats_t *stats);
@@ -0,0 +1,76 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "assets.h"
+
+#define ASSETS_MAGIC        "CLKA"
+#define ASSETS_VERSION      (1)
+#define ASSETS_NAME_LEN     (24)
+
+/* Image layout, see tools/pack_assets.py */
+typedef struct __attribute__((packed))
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t count;
+    uint32_t image_size;
+} assets_header_t;
+
+typedef struct __attribute__((packed))
+{
+    char name[ASSETS_NAME_LEN];
+    uint32_t offset;
+    uint32_t size;
+} assets_entry_t;
+
+static const char *TAG = "assets";
+static const uint8_t *assets_base = NULL;
+static esp_partition_mmap_handle_t assets_mmap_handle;
+
+esp_err_t assets_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ASSETS_PARTITION_SUBTYPE, ASSETS_PARTITION_LABEL);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Failed to find assets partition");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    assets_header_t header;
+    esp_err_t ret = esp_partition_read(part, 0, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (memcmp(header.magic, ASSETS_MAGIC, sizeof(header.magic)) != 0 || header.version != ASSETS_VERSION ||
+        header.image_size > part->size) {
+        ESP_LOGE(TAG, "Assets partition is not flashed or has wrong format");
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    const void *ptr;
+    ret = esp_partition_mmap(part, 0, header.image_size, ESP_PARTITION_MMAP_DATA, &ptr, &assets_mmap_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map assets partition (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+    assets_base = ptr;
+
+    ESP_LOGI(TAG, "Mapped %d assets, %d bytes", header.count, (int)header.image_size);
+    return ESP_OK;
+}
+
+esp_err_t assets_find(const char *name, const void **data, size_t *size)
+{
+    assert(assets_base);
+
+    const assets_header_t *header = (const assets_header_t *)assets_base;
+    const assets_entry_t *entries = (const assets_entry_t *)(assets_base + sizeof(assets_header_t));
+
+    for (int i = 0; i < header->count; i++) {
+        if (strncmp(entries[i].name, name, ASSETS_NAME_LEN) == 0) {
+            *data = assets_base + entries[i].offset;
+            *size = entries[i].size;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
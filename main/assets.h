@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * Read-only asset bundle
+ *
+ * Files from spiffs/ are packed at build time by tools/pack_assets.py into the 'assets'
+ * partition, which is memory mapped at init. Asset data is accessed in place, without
+ * a filesystem or copies.
+ */
+
+#define ASSETS_PARTITION_LABEL      "assets"
+#define ASSETS_PARTITION_SUBTYPE    (0x40)
+
+/**
+ * @brief Map the asset partition and validate its index
+ */
+esp_err_t assets_init(void);
+
+/**
+ * @brief Find asset by file name
+ *
+ * @param[out] data Pointer to the mapped asset data
+ * @param[out] size Asset size [bytes]
+ * @return ESP_OK or ESP_ERR_NOT_FOUND
+ */
+esp_err_t assets_find(const char *name, const void **data, size_t *size);
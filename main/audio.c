@@ -0,0 +1,258 @@
+#include <math.h>
+#include <string.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "bsp/esp-bsp.h"
+#include "es8311.h"
+#include "alloc.h"
+#include "assets.h"
+#include "wav_reader.h"
+#include "audio.h"
+
+/* I2S DMA buffering. The mixer produces one DMA buffer at a time and i2s_channel_write() blocks
+   until a buffer is free, so a sound request waits at most AUDIO_DMA_DESC_NUM buffer periods. */
+#define AUDIO_DMA_DESC_NUM  (2)
+#define AUDIO_DMA_FRAMES    (160)   // 7.3 ms at 22050 Hz
+#define DEFAULT_VOLUME      (60)
+
+#define AUDIO_PRELOAD_MAX   (64 * 1024)     // Larger assets are streamed from the mapped flash
+
+#define FLAG_FALL_ASSET     "16bit_mono_22_05khz.wav"
+
+/* Clips are kept as opened readers, a voice plays its own copy */
+typedef struct {
+    bool loaded;
+    wav_reader_t reader;
+} clip_t;
+
+typedef struct {
+    bool active;
+    wav_reader_t reader;
+} voice_t;
+
+static const char *TAG = "audio";
+static i2s_chan_handle_t i2s_tx_chan;
+static QueueHandle_t audio_req_q = NULL;
+static clip_t clips[SOUND_NUM];
+
+static void *clip_alloc(size_t size)
+{
+    void *buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (buf == NULL) {
+        buf = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    assert(buf != NULL);
+    return buf;
+}
+
+/* Synthesize decaying sine tone */
+static void clip_tone(clip_t *clip, unsigned int freq_hz, unsigned int length_ms, int16_t amplitude)
+{
+    uint32_t frames = AUDIO_SAMPLE_RATE * length_ms / 1000;
+    int16_t *pcm = clip_alloc(frames * sizeof(int16_t));
+
+    for (uint32_t i = 0; i < frames; i++) {
+        float envelope = 1.0f - (float)i / frames;
+        pcm[i] = (int16_t)(amplitude * envelope * sinf(2.0f * (float)M_PI * freq_hz * i / AUDIO_SAMPLE_RATE));
+    }
+    wav_reader_open_pcm(&clip->reader, pcm, frames, AUDIO_SAMPLE_RATE, AUDIO_SAMPLE_RATE);
+    clip->loaded = true;
+}
+
+/* Open WAV asset, small ones are copied to PSRAM first */
+static esp_err_t clip_load(clip_t *clip, const char *name)
+{
+    const void *wav;
+    size_t wav_size;
+    if (assets_find(name, &wav, &wav_size) != ESP_OK) {
+        ESP_LOGW(TAG, "%s asset does not exist!", name);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (wav_size <= AUDIO_PRELOAD_MAX) {
+        void *copy = clip_alloc(wav_size);
+        memcpy(copy, wav, wav_size);
+        wav = copy;
+    }
+
+    esp_err_t ret = wav_reader_open(&clip->reader, wav, wav_size, AUDIO_SAMPLE_RATE);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "%s: unsupported WAV (%s)", name, esp_err_to_name(ret));
+        return ret;
+    }
+    clip->loaded = true;
+
+    ESP_LOGI(TAG, "Loaded %s: format 0x%x, %d ch, %d bit, %d Hz", name, clip->reader.format,
+             clip->reader.channels, clip->reader.bits_per_sample, (int)clip->reader.sample_rate);
+    return ESP_OK;
+}
+
+static void voice_start(voice_t *voices, const clip_t *clip)
+{
+    if (!clip->loaded) {
+        return;
+    }
+
+    /* Take a free voice, or the one closest to its end */
+    voice_t *voice = &voices[0];
+    for (int v = 0; v < AUDIO_VOICES; v++) {
+        if (!voices[v].active) {
+            voice = &voices[v];
+            break;
+        }
+        if (voices[v].reader.data_size - voices[v].reader.pos < voice->reader.data_size - voice->reader.pos) {
+            voice = &voices[v];
+        }
+    }
+    voice->reader = clip->reader;
+    voice->active = true;
+}
+
+#if CONFIG_CHESS_POWER_SAVE
+/* Stop I2S (and its PM lock) and the power amplifier while nothing plays */
+static void audio_output_enable(bool enable)
+{
+    if (enable) {
+        i2s_channel_enable(i2s_tx_chan);
+        bsp_audio_poweramp_enable(true);
+    }
+    else {
+        bsp_audio_poweramp_enable(false);
+        i2s_channel_disable(i2s_tx_chan);
+    }
+}
+#endif
+
+static void audio_mixer(void *arg)
+{
+    static voice_t voices[AUDIO_VOICES];
+    static int32_t mix[AUDIO_DMA_FRAMES];
+    static int16_t pcm[AUDIO_DMA_FRAMES];
+    static int16_t out[AUDIO_DMA_FRAMES];
+    int silent_buffers = 0;
+
+    while (1) {
+        uint8_t sound;
+#if CONFIG_CHESS_POWER_SAVE
+        /* Once the last sound has left the DMA buffers, sleep until the next request */
+        if (silent_buffers > AUDIO_DMA_DESC_NUM) {
+            audio_output_enable(false);
+            xQueuePeek(audio_req_q, &sound, portMAX_DELAY);
+            audio_output_enable(true);
+            silent_buffers = 0;
+        }
+#endif
+        while (xQueueReceive(audio_req_q, &sound, 0) == pdTRUE) {
+            voice_start(voices, &clips[sound]);
+        }
+
+        memset(mix, 0, sizeof(mix));
+        if (silent_buffers <= AUDIO_DMA_DESC_NUM) {
+            silent_buffers++;
+        }
+        for (int v = 0; v < AUDIO_VOICES; v++) {
+            voice_t *voice = &voices[v];
+            if (!voice->active) {
+                continue;
+            }
+            silent_buffers = 0;
+            /* Converted block by block at the codec rate */
+            size_t n = wav_reader_read(&voice->reader, pcm, AUDIO_DMA_FRAMES);
+            for (size_t i = 0; i < n; i++) {
+                mix[i] += pcm[i];
+            }
+            if (n < AUDIO_DMA_FRAMES) {
+                voice->active = false;
+            }
+        }
+
+        for (int i = 0; i < AUDIO_DMA_FRAMES; i++) {
+            int32_t s = mix[i];
+            out[i] = (s > INT16_MAX) ? INT16_MAX : (s < INT16_MIN) ? INT16_MIN : s;
+        }
+
+        /* Blocks until a DMA buffer is free, this paces the mixer */
+        size_t i2s_bytes_written;
+        i2s_channel_write(i2s_tx_chan, out, sizeof(out), &i2s_bytes_written, portMAX_DELAY);
+    }
+}
+
+#if CONFIG_CHESS_AUDIO_BENCH
+/* Decode every clip once and log the cost per DMA buffer */
+static void audio_decode_benchmark(void)
+{
+    static int16_t pcm[AUDIO_DMA_FRAMES];
+
+    for (int s = 0; s < SOUND_NUM; s++) {
+        if (!clips[s].loaded) {
+            continue;
+        }
+        wav_reader_t reader = clips[s].reader;
+        int64_t total = 0, worst = 0;
+        int buffers = 0;
+        size_t n;
+        do {
+            int64_t start = esp_timer_get_time();
+            n = wav_reader_read(&reader, pcm, AUDIO_DMA_FRAMES);
+            int64_t t = esp_timer_get_time() - start;
+            total += t;
+            worst = (t > worst) ? t : worst;
+            buffers++;
+        } while (n == AUDIO_DMA_FRAMES);
+
+        ESP_LOGI(TAG, "Sound %d: format 0x%x, %d Hz, %d buffers, decode avg %d us, max %d us per %d frames",
+                 s, clips[s].reader.format, (int)clips[s].reader.sample_rate, buffers,
+                 (int)(total / buffers), (int)worst, AUDIO_DMA_FRAMES);
+    }
+}
+#endif
+
+esp_err_t audio_init(void)
+{
+    /* Create and configure ES8311 I2C driver */
+    es8311_handle_t es8311_dev = es8311_create(BSP_I2C_NUM, ES8311_ADDRRES_0);
+    const es8311_clock_config_t clk_cfg = BSP_ES8311_SCLK_CONFIG(AUDIO_SAMPLE_RATE);
+    ESP_RETURN_ON_ERROR(es8311_init(es8311_dev, &clk_cfg, ES8311_RESOLUTION_16, ES8311_RESOLUTION_16), TAG, "ES8311 init failed");
+    es8311_voice_volume_set(es8311_dev, DEFAULT_VOLUME, NULL);
+
+    /* Configure I2S TX channel with short DMA buffers, like bsp_audio_init() otherwise */
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(CONFIG_BSP_I2S_NUM, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = AUDIO_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = AUDIO_DMA_FRAMES;
+    chan_cfg.auto_clear = true;
+    ESP_RETURN_ON_ERROR(i2s_new_channel(&chan_cfg, &i2s_tx_chan, NULL), TAG, "I2S channel failed");
+    const i2s_std_config_t std_cfg = BSP_I2S_DUPLEX_MONO_CFG(AUDIO_SAMPLE_RATE);
+    ESP_RETURN_ON_ERROR(i2s_channel_init_std_mode(i2s_tx_chan, &std_cfg), TAG, "I2S init failed");
+    ESP_RETURN_ON_ERROR(i2s_channel_enable(i2s_tx_chan), TAG, "I2S enable failed");
+    bsp_audio_poweramp_enable(true);
+
+    /* Preload clips */
+    clip_tone(&clips[SoundClick], 2000, 15, 8000);
+    clip_tone(&clips[SoundLowTime], 1000, 120, 12000);
+    clip_load(&clips[SoundFlagFall], FLAG_FALL_ASSET);
+#if CONFIG_CHESS_AUDIO_BENCH
+    audio_decode_benchmark();
+#endif
+
+    APP_QUEUE_CREATE(audio_req_q, AUDIO_VOICES, sizeof(uint8_t));
+    assert(audio_req_q != NULL);
+    /* Below clock_loop, so mixing never delays a press. Time-sliced with the renderer, a long
+       LVGL frame holds the mixer off for at most one tick, less than the buffered audio. */
+    APP_TASK_CREATE(audio_mixer, "audio_mixer", 4096, NULL, 5, NULL);
+    return ESP_OK;
+}
+
+void audio_play(sound_t sound)
+{
+    if (audio_req_q == NULL) {
+        return;     // Audio init not finished yet
+    }
+    uint8_t s = sound;
+    xQueueSend(audio_req_q, &s, 0);
+}
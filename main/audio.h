@@ -0,0 +1,33 @@
+#pragma once
+#include "esp_err.h"
+
+/**
+ * Audio engine
+ *
+ * A mixer task keeps the I2S TX stream running and mixes up to AUDIO_VOICES clips preloaded
+ * in PSRAM. A requested sound starts with the next mixed DMA buffer and sounds may overlap.
+ */
+
+#define AUDIO_SAMPLE_RATE   (22050)     // Codec and mixer sample rate [Hz]
+#define AUDIO_VOICES        (4)         // Sounds played at once
+
+typedef enum {
+    SoundClick,         // Move
+    SoundLowTime,       // Low time warning beep
+    SoundFlagFall,      // Flag fall alarm
+    SOUND_NUM
+} sound_t;
+
+/**
+ * @brief Initialize ES8311 codec and I2S, preload clips and start the mixer task
+ *
+ * Assets must be initialized.
+ */
+esp_err_t audio_init(void);
+
+/**
+ * @brief Request a sound, never blocks
+ *
+ * Requests made before audio_init() has finished are ignored.
+ */
+void audio_play(sound_t sound);
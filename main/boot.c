@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "boot.h"
+
+static struct {
+    const char *stage;
+    int64_t time_us;
+} marks[BOOT_MARKS_MAX];
+static unsigned int marks_num;
+static portMUX_TYPE marks_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_mark(const char *stage)
+{
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&marks_lock);
+    if (marks_num < BOOT_MARKS_MAX) {
+        marks[marks_num].stage = stage;
+        marks[marks_num].time_us = now;
+        marks_num++;
+    }
+    taskEXIT_CRITICAL(&marks_lock);
+}
+
+void boot_print(void)
+{
+    unsigned int n;
+    taskENTER_CRITICAL(&marks_lock);
+    n = marks_num;
+    taskEXIT_CRITICAL(&marks_lock);
+
+    printf("%-14s %10s %10s\n", "boot stage", "at [us]", "+ [us]");
+    int64_t prev = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        printf("%-14s %10u %10u\n", marks[i].stage, (unsigned)marks[i].time_us,
+               (unsigned)(marks[i].time_us - prev));
+        prev = marks[i].time_us;
+    }
+}
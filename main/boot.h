@@ -0,0 +1,20 @@
+#pragma once
+
+/**
+ * Boot timeline
+ *
+ * Init stages mark their completion, boot_print() lists the marks with their time since
+ * the start of esp_timer and the time from the previous mark. Marks may come from any task.
+ */
+
+#define BOOT_MARKS_MAX  (16)
+
+/**
+ * @brief Record completion of an init stage, name must be a string literal
+ */
+void boot_mark(const char *stage);
+
+/**
+ * @brief Print the boot timeline
+ */
+void boot_print(void);
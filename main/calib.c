@@ -0,0 +1,261 @@
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "nvs.h"
+#include "soc/rtc.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+#include "alloc.h"
+#include "calib.h"
+
+#define CALIB_NAMESPACE     "calib"
+#define CALIB_KEY_PPB       "ppb"       // Rate correction [ppb]
+#define CALIB_PPS_GPIO      CONFIG_CHESS_CALIB_PPS_GPIO
+#define RTC_XTAL_HZ         (32768)     // Nominal external slow clock crystal
+
+static const char *TAG = "calib";
+static nvs_handle_t nvs;
+static TaskHandle_t calib_handle;
+
+/* Timebase, pulse tracking and run state. Read by the clock and renderer tasks, edges are added
+   from the GPIO ISR */
+static portMUX_TYPE calib_lock = portMUX_INITIALIZER_UNLOCKED;
+static timebase_t timebase;
+static drift_t pulse;
+static int32_t pulse_applied_ppb;
+static calib_ref_t run_ref;
+static int64_t run_end_us;
+
+/* Start of an RTC run and the last result, used by the calib task and the console */
+static int64_t rtc_start_us;
+static uint64_t rtc_start_ticks;
+static int32_t rtc_ppb;
+static int64_t rtc_span_us;
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t run_lock;   // esp_timer is driven by the slow clock in light sleep
+#endif
+
+/* Not in IRAM: edges that arrive while flash is written are missed, drift_edge() bridges them */
+static void pulse_isr(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL_ISR(&calib_lock);
+    drift_edge(&pulse, now);
+    taskEXIT_CRITICAL_ISR(&calib_lock);
+}
+
+/* RTC counter with the esp_timer time it was read at */
+static uint64_t rtc_sample(int64_t *time_us)
+{
+    int64_t before = esp_timer_get_time();
+    uint64_t ticks = rtc_time_get();
+    *time_us = (before + esp_timer_get_time()) / 2;
+    return ticks;
+}
+
+static void run_done(void)
+{
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_release(run_lock);
+#endif
+}
+
+/* Measure the result of a run that ended, apply and store it */
+static void run_finish(calib_ref_t ref)
+{
+    taskENTER_CRITICAL(&calib_lock);
+    bool current = (run_ref == ref);
+    run_ref = CalibRefNone;
+    taskEXIT_CRITICAL(&calib_lock);
+    if (!current) {
+        return;     // Stopped meanwhile
+    }
+    run_done();
+
+    int32_t ppb = 0;
+    bool valid = false;
+    if (ref == CalibRefPulse) {
+        taskENTER_CRITICAL(&calib_lock);
+        drift_t d = pulse;
+        taskEXIT_CRITICAL(&calib_lock);
+        valid = drift_ppb(&d, &ppb);
+        if (!valid) {
+            ESP_LOGW(TAG, "Only %u reference periods, %u rejected", (unsigned)d.intervals, (unsigned)d.rejected);
+        }
+    }
+    else {
+        int64_t now;
+        uint64_t ticks = rtc_sample(&now);
+        int64_t raw = now - rtc_start_us;
+        int64_t ref_us = (int64_t)((ticks - rtc_start_ticks) * 1000000 / RTC_XTAL_HZ);
+        valid = raw > 0;
+        if (valid) {
+            int64_t p = (ref_us - raw) * 1000000000 / raw;
+            ppb = (p > TIMEBASE_PPB_MAX) ? TIMEBASE_PPB_MAX : (p < -TIMEBASE_PPB_MAX) ? -TIMEBASE_PPB_MAX : p;
+            rtc_ppb = ppb;
+            rtc_span_us = raw;
+        }
+    }
+
+    if (valid) {
+        ESP_LOGI(TAG, "Measured %s drift %+ld ppb", (ref == CalibRefPulse) ? "pulse" : "RTC", (long)ppb);
+        calib_set_ppb(ppb);
+    }
+}
+
+/* Waits for the end of a run, started or aborted runs wake it up */
+static void calib_task(void *arg)
+{
+    TickType_t wait = portMAX_DELAY;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        taskENTER_CRITICAL(&calib_lock);
+        calib_ref_t ref = run_ref;
+        int64_t end = run_end_us;
+        taskEXIT_CRITICAL(&calib_lock);
+
+        int64_t now = esp_timer_get_time();
+        wait = portMAX_DELAY;
+        if (ref == CalibRefNone) {
+            continue;
+        }
+        if (now < end) {
+            wait = pdMS_TO_TICKS((end - now + 999) / 1000) + 1;
+            continue;
+        }
+        run_finish(ref);
+    }
+}
+
+esp_err_t calib_init(void)
+{
+    int32_t ppb = 0;
+    ESP_RETURN_ON_ERROR(nvs_open(CALIB_NAMESPACE, NVS_READWRITE, &nvs), TAG, "NVS open failed");
+    nvs_get_i32(nvs, CALIB_KEY_PPB, &ppb);
+    taskENTER_CRITICAL(&calib_lock);    // The renderer may read the time already
+    timebase_init(&timebase, esp_timer_get_time(), ppb);
+    taskEXIT_CRITICAL(&calib_lock);
+    pulse_applied_ppb = timebase.ppb;
+    drift_start(&pulse, CONFIG_CHESS_CALIB_PPS_PERIOD_MS * 1000);
+
+#if CONFIG_PM_ENABLE
+    ESP_RETURN_ON_ERROR(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "calib", &run_lock), TAG, "PM lock failed");
+#endif
+
+#if CALIB_PPS_GPIO >= 0
+    const gpio_config_t io_cfg = {
+        .pin_bit_mask = 1ULL << CALIB_PPS_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&io_cfg), TAG, "GPIO config failed");
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(CALIB_PPS_GPIO, pulse_isr, NULL), TAG, "ISR add failed");
+#endif
+
+    APP_TASK_CREATE(calib_task, "calib", 2560, NULL, 2, &calib_handle);
+    ESP_LOGI(TAG, "Timebase correction %+ld ppb", (long)timebase.ppb);
+    return ESP_OK;
+}
+
+int64_t calib_now_us(void)
+{
+    return calib_correct_us(esp_timer_get_time());
+}
+
+int64_t calib_correct_us(int64_t raw_us)
+{
+    taskENTER_CRITICAL(&calib_lock);
+    int64_t t = timebase_correct(&timebase, raw_us);
+    taskEXIT_CRITICAL(&calib_lock);
+    return t;
+}
+
+esp_err_t calib_start(calib_ref_t ref, uint32_t duration_s, int64_t period_us)
+{
+    ESP_RETURN_ON_FALSE(duration_s > 0, ESP_ERR_INVALID_ARG, TAG, "No duration");
+#if CALIB_PPS_GPIO < 0
+    ESP_RETURN_ON_FALSE(ref != CalibRefPulse, ESP_ERR_NOT_SUPPORTED, TAG, "No pulse input, see CHESS_CALIB_PPS_GPIO");
+#endif
+#if !CONFIG_RTC_CLK_SRC_EXT_CRYS
+    ESP_RETURN_ON_FALSE(ref != CalibRefRtc, ESP_ERR_NOT_SUPPORTED, TAG, "RTC slow clock is not an external crystal");
+#endif
+    ESP_RETURN_ON_FALSE(ref == CalibRefPulse || ref == CalibRefRtc, ESP_ERR_INVALID_ARG, TAG, "No reference");
+    ESP_RETURN_ON_FALSE(ref == CalibRefRtc || period_us > 0, ESP_ERR_INVALID_ARG, TAG, "No pulse period");
+
+    calib_stop();
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_acquire(run_lock);
+#endif
+    int64_t now;
+    if (ref == CalibRefRtc) {
+        rtc_start_ticks = rtc_sample(&rtc_start_us);
+        now = rtc_start_us;
+    }
+    else {
+        now = esp_timer_get_time();
+    }
+
+    taskENTER_CRITICAL(&calib_lock);
+    if (ref == CalibRefPulse) {
+        drift_start(&pulse, period_us);
+        pulse_applied_ppb = timebase.ppb;
+    }
+    run_ref = ref;
+    run_end_us = now + (int64_t)duration_s * 1000000;
+    taskEXIT_CRITICAL(&calib_lock);
+    xTaskNotifyGive(calib_handle);
+    return ESP_OK;
+}
+
+void calib_stop(void)
+{
+    taskENTER_CRITICAL(&calib_lock);
+    bool running = (run_ref != CalibRefNone);
+    run_ref = CalibRefNone;
+    taskEXIT_CRITICAL(&calib_lock);
+    if (running) {
+        run_done();
+        xTaskNotifyGive(calib_handle);
+    }
+}
+
+esp_err_t calib_set_ppb(int32_t ppb)
+{
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&calib_lock);
+    timebase_set_ppb(&timebase, now, ppb);
+    ppb = timebase.ppb;
+    /* Pulses tracked from here on show the residual drift of the corrected timebase */
+    drift_start(&pulse, pulse.period_us);
+    pulse_applied_ppb = ppb;
+    taskEXIT_CRITICAL(&calib_lock);
+
+    ESP_RETURN_ON_ERROR(nvs_set_i32(nvs, CALIB_KEY_PPB, ppb), TAG, "NVS write failed");
+    return nvs_commit(nvs);
+}
+
+void calib_get_stats(calib_stats_t *stats)
+{
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&calib_lock);
+    stats->ppb = timebase.ppb;
+    stats->running = run_ref;
+    stats->remaining_us = (run_ref != CalibRefNone && run_end_us > now) ? run_end_us - now : 0;
+    stats->pulse = pulse;
+    stats->pulse_applied_ppb = pulse_applied_ppb;
+    taskEXIT_CRITICAL(&calib_lock);
+    stats->rtc_ppb = rtc_ppb;
+    stats->rtc_span_us = rtc_span_us;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "timebase.h"
+
+/**
+ * Timebase calibration
+ *
+ * Measures the esp_timer rate (40 MHz crystal) against a reference and stores the correction
+ * in NVS. Clock accounting uses calib_now_us() / calib_correct_us(), so the correction is
+ * applied to every move from boot on.
+ *
+ * References:
+ * - pulse: rising edges on CONFIG_CHESS_CALIB_PPS_GPIO, e.g. a GPS 1 PPS output or a signal
+ *   generator. The edges are also tracked outside of a run, so the residual drift of the
+ *   corrected timebase can be checked.
+ * - rtc: the RTC slow clock. Only useful with an external 32 kHz crystal, the internal RC
+ *   oscillator is far less stable than the main crystal.
+ *
+ * While a clock runs the chip does not enter light sleep, so the crystal alone drives the
+ * timebase during a game.
+ */
+
+typedef enum {
+    CalibRefNone,
+    CalibRefPulse,
+    CalibRefRtc,
+} calib_ref_t;
+
+typedef struct {
+    int32_t ppb;                // Applied correction
+    calib_ref_t running;        // Reference of the run in progress
+    int64_t remaining_us;       // Time left in the run
+    drift_t pulse;              // Reference edges since the last run started or ended
+    int32_t pulse_applied_ppb;  // Correction applied while the edges were tracked
+    int32_t rtc_ppb;            // Result of the last RTC run
+    int64_t rtc_span_us;        // Length of the last RTC run, 0 if there was none
+} calib_stats_t;
+
+/**
+ * @brief Load the stored correction and start tracking reference pulses
+ *
+ * Call after journal_init(), which initializes NVS.
+ */
+esp_err_t calib_init(void);
+
+/**
+ * @brief Corrected current time [us]
+ */
+int64_t calib_now_us(void);
+
+/**
+ * @brief Convert an esp_timer timestamp to corrected time [us]
+ */
+int64_t calib_correct_us(int64_t raw_us);
+
+/**
+ * @brief Start a measurement, the result is applied and stored when it ends
+ *
+ * @param period_us Pulse period, ignored for CalibRefRtc
+ */
+esp_err_t calib_start(calib_ref_t ref, uint32_t duration_s, int64_t period_us);
+
+/**
+ * @brief Abort the measurement in progress
+ */
+void calib_stop(void);
+
+/**
+ * @brief Apply and store a correction [ppb]
+ */
+esp_err_t calib_set_ppb(int32_t ppb);
+
+/**
+ * @brief Get the applied correction and the drift measurements
+ */
+void calib_get_stats(calib_stats_t *stats);
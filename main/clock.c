@@ -0,0 +1,400 @@
+#include "clock.h"
+
+static const tc_period_t *clock_period(const chess_clock_t *clk, enum Players player)
+{
+    return &time_controls[clk->control].periods[clk->period[player]];
+}
+
+/* Put 'player' into the period reached after their moves, without adding any time */
+static void clock_find_period(chess_clock_t *clk, enum Players player)
+{
+    const time_control_t *tc = &time_controls[clk->control];
+    unsigned int end = 0;
+
+    clk->period[player] = 0;
+    clk->period_end[player] = tc->periods[0].moves;
+    for (unsigned int i = 0; i < tc->periods_num; i++) {
+        clk->period[player] = i;
+        if (tc->periods[i].moves == 0) {
+            clk->period_end[player] = 0;
+            break;
+        }
+        end += tc->periods[i].moves;
+        clk->period_end[player] = (i + 1 < tc->periods_num) ? end : 0;
+        if (clk->player_moves[player] < end) {
+            break;
+        }
+    }
+}
+
+static void clock_reset(chess_clock_t *clk)
+{
+    clk->state = Setup;
+    clk->moves = 0;
+    clk->delay_left_ms = 0;
+    for (int p = Player1; p <= Player2; p++) {
+        clk->remaining_ms[p] = clk->set_time_ms;
+        clk->player_moves[p] = 0;
+        clock_find_period(clk, p);
+    }
+}
+
+/* Charge the active player for the time since mark_us.
+   While the turn is running only whole milliseconds are charged and the sub-millisecond rest
+   is carried over in mark_us. At the end of the turn the rest is rounded to nearest.
+   A turn may end before mark_us if the input was queued while the clock kept running, the
+   player then gets the time charged after the input back. */
+static void clock_charge(chess_clock_t *clk, int64_t now_us, bool end_of_turn)
+{
+    int64_t start_us = clk->mark_us;
+    int64_t elapsed_us = now_us - clk->mark_us;
+    if (elapsed_us < 0 && end_of_turn) {
+        /* Give back what this turn used after the input: main time first, it ran last, then
+           the delay */
+        const tc_period_t *period = clock_period(clk, clk->active_player);
+        uint32_t charged_ms = clk->turn_start_ms - clk->remaining_ms[clk->active_player];
+        uint32_t delay_used_ms = (period->bonus == BonusDelay) ? period->bonus_ms - clk->delay_left_ms : 0;
+        uint32_t back_ms = (uint32_t)((-elapsed_us + 500) / 1000);
+        uint32_t time_back_ms = (back_ms < charged_ms) ? back_ms : charged_ms;
+        back_ms -= time_back_ms;
+        clk->remaining_ms[clk->active_player] += time_back_ms;
+        clk->delay_left_ms += (back_ms < delay_used_ms) ? back_ms : delay_used_ms;
+        clk->mark_us = now_us;
+        return;
+    }
+    if (elapsed_us <= 0) {
+        return;
+    }
+
+    int64_t elapsed_ms = elapsed_us / 1000;
+    if (end_of_turn) {
+        if (elapsed_us % 1000 >= 500) {
+            elapsed_ms++;
+        }
+        clk->mark_us = now_us;
+    }
+    else {
+        clk->mark_us += elapsed_ms * 1000;
+    }
+
+    /* US delay runs out first */
+    uint32_t delay_ms = (elapsed_ms < clk->delay_left_ms) ? (uint32_t)elapsed_ms : clk->delay_left_ms;
+    clk->delay_left_ms -= delay_ms;
+    elapsed_ms -= delay_ms;
+
+    uint32_t *remaining = &clk->remaining_ms[clk->active_player];
+    if (elapsed_ms >= *remaining) {
+        clk->flag_us = start_us + ((int64_t)delay_ms + *remaining) * 1000;
+        *remaining = 0;
+        clk->state = Timeout;
+    }
+    else {
+        *remaining -= (uint32_t)elapsed_ms;
+    }
+}
+
+/* Start the turn of 'player' at now_us, or resume it after a pause */
+static void clock_start_turn(chess_clock_t *clk, enum Players player, int64_t now_us)
+{
+    if (clk->state != Pause || clk->active_player != player) {
+        const tc_period_t *period = clock_period(clk, player);
+        clk->turn_start_ms = clk->remaining_ms[player];
+        clk->delay_left_ms = (period->bonus == BonusDelay) ? period->bonus_ms : 0;
+    }
+    clk->active_player = player;
+    clk->state = Playing;
+    clk->mark_us = now_us;
+}
+
+/* Apply the bonus of the move just completed by 'player' and advance their period */
+static void clock_complete_move(chess_clock_t *clk, enum Players player)
+{
+    const tc_period_t *period = clock_period(clk, player);
+    uint32_t used_ms = clk->turn_start_ms - clk->remaining_ms[player];
+    uint32_t bonus_ms = 0;
+
+    if (period->bonus == BonusFischer) {
+        bonus_ms = period->bonus_ms;
+    }
+    else if (period->bonus == BonusBronstein) {
+        bonus_ms = (used_ms < period->bonus_ms) ? used_ms : period->bonus_ms;
+    }
+    clk->remaining_ms[player] += bonus_ms;
+    clk->last_move_ms = used_ms;
+    clk->last_bonus_ms = bonus_ms;
+    clk->moves++;
+
+    clk->player_moves[player]++;
+    if (clk->player_moves[player] == clk->period_end[player]) {
+        const time_control_t *tc = &time_controls[clk->control];
+        unsigned int next = clk->period[player] + 1;
+        clk->period[player] = next;
+        clk->remaining_ms[player] += tc->periods[next].time_ms;
+        clk->period_end[player] = (tc->periods[next].moves && next + 1 < tc->periods_num) ?
+                                  clk->player_moves[player] + tc->periods[next].moves : 0;
+    }
+}
+
+/* Player 'player' pressed their button: pass the turn to the opponent */
+static void clock_finish_turn(chess_clock_t *clk, enum Players player, int64_t now_us)
+{
+    enum Players opponent = (player == Player1) ? Player2 : Player1;
+
+    switch (clk->state) {
+        case Timeout:
+            clock_reset(clk);
+            break;
+        case Playing:
+            if (clk->active_player == player) {
+                clock_charge(clk, now_us, true);
+                if (clk->state == Playing) {
+                    clock_complete_move(clk, player);
+                    clock_start_turn(clk, opponent, now_us);
+                }
+            }
+            break;
+        case Setup:
+        case Pause:
+            clock_start_turn(clk, opponent, now_us);
+            break;
+    }
+}
+
+static uint32_t clock_changes(const chess_clock_t *clk, const chess_clock_t *prev)
+{
+    uint32_t changes = 0;
+
+    if (clk->state != prev->state || clk->active_player != prev->active_player) {
+        changes |= CLOCK_CHANGED_PLAYER;
+    }
+    if (clk->set_time_ms != prev->set_time_ms || clk->control != prev->control ||
+        clock_display_sec(clk->remaining_ms[Player1]) != clock_display_sec(prev->remaining_ms[Player1]) ||
+        clock_display_sec(clk->remaining_ms[Player2]) != clock_display_sec(prev->remaining_ms[Player2])) {
+        changes |= CLOCK_CHANGED_TIME;
+    }
+    if (clk->state == Timeout && prev->state != Timeout) {
+        changes |= CLOCK_TIMEOUT;
+    }
+    if (clk->moves != prev->moves) {
+        changes |= CLOCK_MOVE;
+    }
+    return changes;
+}
+
+void clock_init(chess_clock_t *clk, uint32_t set_time_ms, uint32_t time_step_ms)
+{
+    clk->control = 0;
+    clk->set_time_ms = set_time_ms;
+    clk->time_step_ms = time_step_ms;
+    clk->time_adjusted = false;
+    clk->active_player = Player1;
+    clk->mark_us = 0;
+    clk->flag_us = 0;
+    clk->turn_start_ms = set_time_ms;
+    clk->last_move_ms = 0;
+    clk->last_bonus_ms = 0;
+    clock_reset(clk);
+}
+
+void clock_restore(chess_clock_t *clk, const clock_view_t *saved)
+{
+    clk->control = (saved->control < time_controls_num) ? saved->control : 0;
+    clk->set_time_ms = saved->set_time_ms;
+    clk->time_adjusted = (saved->set_time_ms != time_controls[clk->control].periods[0].time_ms);
+    clk->active_player = saved->active_player;
+    clk->state = (saved->state == Playing) ? Pause : saved->state;
+    clk->mark_us = 0;
+    clk->flag_us = -CLOCK_FLAG_HOLD_US;     // A restored flag fall is not held
+    clk->delay_left_ms = 0;
+    clk->moves = saved->player_moves[Player1] + saved->player_moves[Player2];
+    for (int p = Player1; p <= Player2; p++) {
+        clk->remaining_ms[p] = saved->remaining_ms[p];
+        clk->player_moves[p] = saved->player_moves[p];
+        clock_find_period(clk, p);
+    }
+    clk->turn_start_ms = saved->remaining_ms[saved->active_player];
+}
+
+uint32_t clock_input(chess_clock_t *clk, enum ClockInputs input, int64_t now_us)
+{
+    const chess_clock_t prev = *clk;
+
+    if (clk->state == Timeout && now_us < clk->flag_us + CLOCK_FLAG_HOLD_US) {
+        /* Pressed before the flag fell but confirmed after it: the move or pause still counts,
+           clock_charge() gives back the time charged past now_us. Anything else would have had
+           no effect on the running clock, and a press racing the flag must not reset the game.
+           The end of a turn is rounded to nearest ms, within 0.5 ms of the flag it falls anyway. */
+        bool ends_turn = (input == InputPause) ||
+                         (input == InputP1Done && clk->active_player == Player1) ||
+                         (input == InputP2Done && clk->active_player == Player2);
+        if (now_us > clk->flag_us - 500 || !ends_turn) {
+            return 0;
+        }
+        clk->state = Playing;
+        clk->mark_us = clk->flag_us;    // Nothing was charged past the flag
+    }
+
+    switch (input) {
+        case InputP2Done: {
+            clock_finish_turn(clk, Player2, now_us);
+            break;
+        }
+        case InputP1Done: {
+            clock_finish_turn(clk, Player1, now_us);
+            break;
+        }
+        case InputTimeUp: {
+            if (clk->state == Setup) {
+                clk->set_time_ms += clk->time_step_ms;
+                clk->time_adjusted = true;
+                clock_reset(clk);
+            }
+            else if (clk->state == Timeout) {
+                clock_reset(clk);
+            }
+            break;
+        }
+        case InputTimeDown: {
+            if (clk->state == Setup) {
+                if (clk->set_time_ms > clk->time_step_ms) {
+                    clk->set_time_ms -= clk->time_step_ms;
+                    clk->time_adjusted = true;
+                }
+                clock_reset(clk);
+            }
+            else if (clk->state == Timeout) {
+                clock_reset(clk);
+            }
+            break;
+        }
+        case InputPause: {
+            if (clk->state == Setup || clk->state == Pause) {
+                clock_start_turn(clk, clk->active_player, now_us);
+            }
+            else if (clk->state == Playing) {
+                clock_charge(clk, now_us, true);
+                if (clk->state == Playing) {
+                    clk->state = Pause;
+                }
+            }
+            else if (clk->state == Timeout) {
+                clock_reset(clk);
+            }
+            break;
+        }
+        case InputReset: {
+            if (clk->state == Setup) {
+                clk->control = (clk->control + 1) % time_controls_num;
+                if (!clk->time_adjusted) {
+                    clk->set_time_ms = time_controls[clk->control].periods[0].time_ms;
+                }
+            }
+            clock_reset(clk);
+            break;
+        }
+    }
+
+    return clock_changes(clk, &prev);
+}
+
+uint32_t clock_update(chess_clock_t *clk, int64_t now_us)
+{
+    if (clk->state != Playing) {
+        return 0;
+    }
+
+    const chess_clock_t prev = *clk;
+    clock_charge(clk, now_us, false);
+    return clock_changes(clk, &prev);
+}
+
+uint32_t clock_remaining_ms(const chess_clock_t *clk, enum Players player, int64_t now_us)
+{
+    uint32_t remaining = clk->remaining_ms[player];
+    if (clk->state != Playing || clk->active_player != player || now_us <= clk->mark_us) {
+        return remaining;
+    }
+
+    int64_t elapsed_ms = (now_us - clk->mark_us) / 1000 - clk->delay_left_ms;
+    if (elapsed_ms <= 0) {
+        return remaining;
+    }
+    return (elapsed_ms >= remaining) ? 0 : remaining - (uint32_t)elapsed_ms;
+}
+
+void clock_get_view(const chess_clock_t *clk, int64_t now_us, clock_view_t *view)
+{
+    view->state = clk->state;
+    view->active_player = clk->active_player;
+    view->control = clk->control;
+    view->set_time_ms = clk->set_time_ms;
+    for (int p = Player1; p <= Player2; p++) {
+        view->remaining_ms[p] = clock_remaining_ms(clk, p, now_us);
+        view->player_moves[p] = clk->player_moves[p];
+    }
+    view->time_us = now_us;
+    view->delay_left_ms = 0;
+    if (clk->state == Playing) {
+        int64_t used_ms = (now_us > clk->mark_us) ? (now_us - clk->mark_us) / 1000 : 0;
+        view->delay_left_ms = (used_ms < clk->delay_left_ms) ? clk->delay_left_ms - (uint32_t)used_ms : 0;
+    }
+}
+
+uint32_t clock_view_remaining_ms(const clock_view_t *view, int64_t now_us)
+{
+    uint32_t remaining = view->remaining_ms[view->active_player];
+    if (view->state != Playing || now_us <= view->time_us) {
+        return remaining;
+    }
+
+    int64_t elapsed_ms = (now_us - view->time_us) / 1000 - view->delay_left_ms;
+    if (elapsed_ms <= 0) {
+        return remaining;
+    }
+    return (elapsed_ms >= remaining) ? 0 : remaining - (uint32_t)elapsed_ms;
+}
+
+int64_t clock_view_next_tenth_us(const clock_view_t *view, int64_t now_us)
+{
+    uint32_t remaining = clock_view_remaining_ms(view, now_us);
+    if (view->state != Playing || remaining == 0) {
+        return CLOCK_NO_DEADLINE;
+    }
+
+    /* Same rounding as clock_next_deadline_us(), one tenth instead of one second. Above the
+       threshold the readout switches to tenths before the next whole second. */
+    uint32_t to_change_ms;
+    if (remaining >= CLOCK_TENTHS_BELOW_MS) {
+        to_change_ms = remaining - (CLOCK_TENTHS_BELOW_MS - 1);
+    }
+    else {
+        to_change_ms = remaining % 100;
+        if (to_change_ms == 0) {
+            to_change_ms = 100;
+        }
+    }
+    int64_t start_us = (now_us > view->time_us) ? now_us : view->time_us;
+    uint32_t delay_ms = view->delay_left_ms;
+    if (now_us > view->time_us) {
+        int64_t used_ms = (now_us - view->time_us) / 1000;
+        delay_ms = (used_ms < delay_ms) ? delay_ms - (uint32_t)used_ms : 0;
+    }
+    return start_us + ((int64_t)delay_ms + to_change_ms) * 1000;
+}
+
+int64_t clock_next_deadline_us(const chess_clock_t *clk, int64_t now_us)
+{
+    if (clk->state != Playing) {
+        return CLOCK_NO_DEADLINE;
+    }
+
+    /* Displayed seconds are rounded up, so the readout changes when the remaining time
+       crosses the next whole second below it */
+    uint32_t remaining = clk->remaining_ms[clk->active_player];
+    uint32_t to_change_ms = remaining % 1000;
+    if (to_change_ms == 0) {
+        to_change_ms = (remaining == 0) ? 0 : 1000;
+    }
+    int64_t deadline = clk->mark_us + ((int64_t)clk->delay_left_ms + to_change_ms) * 1000;
+    return (deadline > now_us) ? deadline : now_us;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "time_control.h"
+
+/**
+ * Chess clock timekeeping core
+ *
+ * All accounting is done against a monotonic microsecond timestamp supplied by the caller
+ * (esp_timer_get_time() on the target). Remaining time is held in milliseconds and every
+ * player is charged exactly the time between the start and the end of their turn, so the
+ * display refresh rate has no influence on the result. Increments, delays and periods follow
+ * the selected entry of time_controls[].
+ *
+ * The core has no dependency on FreeRTOS, BSP or LVGL.
+ */
+
+enum ClockStates {
+    Setup,
+    Pause,
+    Playing,
+    Timeout
+};
+enum Players { Player1, Player2 };
+
+/* Logical clock inputs, mapped from board buttons by the application */
+enum ClockInputs {
+    InputP1Done,    // Player 1 finished turn
+    InputP2Done,    // Player 2 finished turn
+    InputTimeUp,    // Increase starting time
+    InputTimeDown,  // Decrease starting time
+    InputPause,     // Play / pause
+    InputReset,     // Reset to starting time, in Setup select next time control (see clock_input())
+};
+
+/* Change flags returned by clock_input() and clock_update() */
+#define CLOCK_CHANGED_TIME      (1 << 0)    // Displayed time, starting time or time control changed
+#define CLOCK_CHANGED_PLAYER    (1 << 1)    // Clock state or active player changed
+#define CLOCK_TIMEOUT           (1 << 2)    // Flag fell
+#define CLOCK_MOVE              (1 << 3)    // A player completed a move, see last_move_ms
+
+#define CLOCK_NO_DEADLINE       INT64_MAX
+#define CLOCK_TENTHS_BELOW_MS   (10 * 1000)     // Readouts show tenths of a second below this
+#define CLOCK_FLAG_HOLD_US      (500 * 1000)    // Inputs ignored after the flag fell, see clock_input()
+
+typedef struct {
+    enum ClockStates state;
+    enum Players active_player;
+    uint8_t control;            // Index into time_controls[]
+    uint32_t set_time_ms;       // Starting time, time of the first period
+    uint32_t time_step_ms;      // Time to add or subtract with +/- button press
+    bool time_adjusted;         // Starting time was set with +/-, a new time control keeps it
+    uint32_t remaining_ms[2];   // Remaining time of each player, valid as of mark_us
+    int64_t mark_us;            // Timestamp up to which the active player has been charged
+    uint32_t delay_left_ms;     // Delay left before the active clock counts down, as of mark_us
+    int64_t flag_us;            // Instant the flag fell, valid in Timeout
+    uint32_t turn_start_ms;     // Remaining time of the active player when the turn started
+    uint32_t last_move_ms;      // Time used by the last completed move
+    uint32_t last_bonus_ms;     // Increment or time given back after the last move
+    uint16_t moves;             // Moves completed in this game
+    uint16_t player_moves[2];   // Moves completed by each player
+    uint8_t period[2];          // Current period of each player
+    uint16_t period_end[2];     // player_moves at which the period ends, 0 for never
+} chess_clock_t;
+
+/* Consistent copy of the clock state handed to the renderer and other consumers */
+typedef struct {
+    enum ClockStates state;
+    enum Players active_player;
+    uint8_t control;
+    uint32_t set_time_ms;
+    uint32_t remaining_ms[2];
+    uint16_t player_moves[2];
+    int64_t time_us;            // Time the remaining times refer to
+    uint32_t delay_left_ms;     // Delay of the active player left at time_us
+} clock_view_t;
+
+/**
+ * @brief Initialize clock in Setup state with the first time control (sudden death)
+ */
+void clock_init(chess_clock_t *clk, uint32_t set_time_ms, uint32_t time_step_ms);
+
+/**
+ * @brief Restore a saved game
+ *
+ * A game that was running is restored paused, it continues with the Play/Pause button.
+ * Periods are derived from the moves played.
+ */
+void clock_restore(chess_clock_t *clk, const clock_view_t *saved);
+
+/**
+ * @brief Process an input that happened at now_us
+ *
+ * now_us may lie before the last clock_update(), e.g. for an event that waited in a queue.
+ * Time charged after the input is then given back to the player. That holds after the flag
+ * fell too: a move or pause made before the flag instant is applied to the running clock.
+ * Other inputs in Timeout are ignored until CLOCK_FLAG_HOLD_US after the flag instant, so a
+ * press that was still being debounced or queued never resets the finished game.
+ *
+ * In Setup InputReset selects the next time control. It loads the control's starting time
+ * unless the starting time was set with +/-, which is kept.
+ *
+ * @return CLOCK_* change flags
+ */
+uint32_t clock_input(chess_clock_t *clk, enum ClockInputs input, int64_t now_us);
+
+/**
+ * @brief Charge the active player up to now_us and detect flag fall
+ *
+ * @return CLOCK_* change flags
+ */
+uint32_t clock_update(chess_clock_t *clk, int64_t now_us);
+
+/**
+ * @brief Remaining time of a player at now_us, without charging it
+ */
+uint32_t clock_remaining_ms(const chess_clock_t *clk, enum Players player, int64_t now_us);
+
+/**
+ * @brief Fill a snapshot of the clock as of now_us
+ */
+void clock_get_view(const chess_clock_t *clk, int64_t now_us, clock_view_t *view);
+
+/**
+ * @brief Remaining time of the active player at now_us, extrapolated from a snapshot
+ *
+ * Lets the renderer draw a running clock between snapshots without asking the clock owner.
+ */
+uint32_t clock_view_remaining_ms(const clock_view_t *view, int64_t now_us);
+
+/**
+ * @brief Timestamp of the next change of the active readout that no new snapshot brings
+ *
+ * That is every tenth of a second below CLOCK_TENTHS_BELOW_MS, and the switch to tenths.
+ *
+ * @return Absolute timestamp [us] or CLOCK_NO_DEADLINE if no clock is running
+ */
+int64_t clock_view_next_tenth_us(const clock_view_t *view, int64_t now_us);
+
+/**
+ * @brief Timestamp of the next change of the displayed time (or of the flag fall)
+ *
+ * @return Absolute timestamp [us] or CLOCK_NO_DEADLINE if no clock is running
+ */
+int64_t clock_next_deadline_us(const chess_clock_t *clk, int64_t now_us);
+
+/**
+ * @brief Convert milliseconds to displayed whole seconds
+ *
+ * Rounded up, so that 0 is shown only when the flag has fallen.
+ */
+static inline unsigned int clock_display_sec(uint32_t ms)
+{
+    return (ms + 999) / 1000;
+}
+
+/**
+ * @brief Convert milliseconds to displayed tenths of a second, rounded up
+ */
+static inline unsigned int clock_display_tenths(uint32_t ms)
+{
+    return (ms + 99) / 100;
+}
@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "esp_console.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "alloc.h"
+#include "boot.h"
+#include "calib.h"
+#include "input.h"
+#include "journal.h"
+#include "gamelog.h"
+#include "latency.h"
+#include "lcd.h"
+#include "power.h"
+#include "console.h"
+
+#define TASKS_MAX   (32)    // Tasks remembered between 'tasks' calls
+
+static const char *TAG = "console";
+
+/* Run time counters of the previous 'tasks' call, CPU share is reported for the interval */
+static struct {
+    TaskHandle_t handle;
+    configRUN_TIME_COUNTER_TYPE run_time;
+} prev_tasks[TASKS_MAX];
+static configRUN_TIME_COUNTER_TYPE prev_total;
+
+static configRUN_TIME_COUNTER_TYPE prev_run_time(TaskHandle_t handle)
+{
+    for (int i = 0; i < TASKS_MAX; i++) {
+        if (prev_tasks[i].handle == handle) {
+            return prev_tasks[i].run_time;
+        }
+    }
+    return 0;
+}
+
+static void print_heap(const char *name, uint32_t caps)
+{
+    printf("%-9s free %7u  min free %7u  largest %7u  total %7u\n", name,
+           (unsigned)heap_caps_get_free_size(caps), (unsigned)heap_caps_get_minimum_free_size(caps),
+           (unsigned)heap_caps_get_largest_free_block(caps), (unsigned)heap_caps_get_total_size(caps));
+}
+
+/* tasks: CPU share since the previous call, stack high water marks, input ring and heap */
+static int cmd_tasks(int argc, char **argv)
+{
+    UBaseType_t n = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *status = malloc(n * sizeof(TaskStatus_t));
+    if (status == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    configRUN_TIME_COUNTER_TYPE total;
+    n = uxTaskGetSystemState(status, n, &total);
+    configRUN_TIME_COUNTER_TYPE elapsed = total - prev_total;
+
+    static const char states[] = { 'X', 'R', 'B', 'S', 'D', '?' };
+    printf("%-16s %4s %2s %6s %10s\n", "task", "prio", "st", "cpu%", "stack free");
+    for (UBaseType_t i = 0; i < n; i++) {
+        configRUN_TIME_COUNTER_TYPE run = status[i].ulRunTimeCounter - prev_run_time(status[i].xHandle);
+        unsigned int permille = elapsed ? (unsigned int)(run * 1000 / elapsed) : 0;
+        eTaskState st = status[i].eCurrentState;
+        printf("%-16s %4u %2c %4u.%u %10u\n", status[i].pcTaskName, (unsigned)status[i].uxCurrentPriority,
+               states[(st <= eDeleted) ? st : eInvalid], permille / 10, permille % 10,
+               (unsigned)status[i].usStackHighWaterMark);
+    }
+
+    memset(prev_tasks, 0, sizeof(prev_tasks));
+    for (UBaseType_t i = 0; i < n && i < TASKS_MAX; i++) {
+        prev_tasks[i].handle = status[i].xHandle;
+        prev_tasks[i].run_time = status[i].ulRunTimeCounter;
+    }
+    prev_total = total;
+    free(status);
+
+    input_stats_t in;
+    input_get_stats(&in);
+    printf("\ninput ring %u/%u  presses %u  dropped %u  bounces %u\n\n", (unsigned)in.pending,
+           INPUT_RING_SIZE, (unsigned)in.presses, (unsigned)in.dropped, (unsigned)in.glitches);
+
+    print_heap("internal", MALLOC_CAP_INTERNAL);
+    print_heap("psram", MALLOC_CAP_SPIRAM);
+
+    heap_guard_stats_t guard;
+    heap_guard_get_stats(&guard);
+    if (guard.allocations) {
+        printf("heap allocations after init %u, last %u bytes by %s\n", (unsigned)guard.allocations,
+               (unsigned)guard.last_size, guard.last_task ? pcTaskGetName(guard.last_task) : "?");
+    }
+    return 0;
+}
+
+/* latency [reset] */
+static int cmd_latency(int argc, char **argv)
+{
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            printf("Usage: latency [reset]\n");
+            return 1;
+        }
+        latency_reset();
+        return 0;
+    }
+
+    printf("%-10s %8s %8s %8s %8s %8s\n", "[us]", "n", "min", "p50", "p99", "max");
+    for (int s = 0; s < LATENCY_STAGE_NUM; s++) {
+        latency_summary_t sum;
+        latency_get(s, &sum);
+        printf("%-10s %8u %8u %8u %8u %8u\n", latency_stage_name(s), (unsigned)sum.count,
+               (unsigned)sum.min_us, (unsigned)sum.p50_us, (unsigned)sum.p99_us, (unsigned)sum.max_us);
+    }
+    return 0;
+}
+
+/* power: time per mode, wake-ups and estimated SoC current */
+static int cmd_power(int argc, char **argv)
+{
+    power_stats_t p;
+    power_get_stats(&p);
+    int64_t awake_us = p.uptime_us - p.light_sleep_us;
+
+    printf("uptime       %10u ms\n", (unsigned)(p.uptime_us / 1000));
+    printf("running      %10u ms  %3u %%\n", (unsigned)(p.running_us / 1000), (unsigned)(p.running_us * 100 / p.uptime_us));
+    printf("awake        %10u ms  %3u %%\n", (unsigned)(awake_us / 1000), (unsigned)(awake_us * 100 / p.uptime_us));
+    printf("light sleep  %10u ms  %3u %%  %u wake-ups\n", (unsigned)(p.light_sleep_us / 1000),
+           (unsigned)(p.light_sleep_us * 100 / p.uptime_us), (unsigned)p.light_sleeps);
+    printf("SoC current  %10u uA estimated, display and codec not included\n", (unsigned)p.average_ua);
+    return 0;
+}
+
+/* boot: init stage timeline */
+static int cmd_boot(int argc, char **argv)
+{
+    boot_print();
+    return 0;
+}
+
+/* journal: checkpoint writes and flash wear projection */
+static int cmd_journal(int argc, char **argv)
+{
+    journal_stats_t j;
+    journal_get_stats(&j);
+    unsigned int uptime_s = (unsigned int)(esp_timer_get_time() / 1000000);
+    unsigned int per_hour = uptime_s ? (unsigned int)((uint64_t)j.writes * 3600 / uptime_s) : 0;
+    unsigned int entries_per_hour = uptime_s ? (unsigned int)((uint64_t)j.entries * 3600 / uptime_s) : 0;
+
+    printf("checkpoints %u (%u/h), coalesced %u, failed %u, %u entries\n", (unsigned)j.writes, per_hour,
+           (unsigned)j.coalesced, (unsigned)j.failed, (unsigned)j.entries);
+    printf("nvs entries %u/%u used\n", (unsigned)j.used_entries, (unsigned)j.total_entries);
+
+    /* Each entry takes 32 bytes, NVS erases a 126 entry page when it recycles it */
+    unsigned int sectors = j.total_entries / 126;
+    if (sectors) {
+        unsigned int day_entries = entries_per_hour * 10;
+        printf("10 h day at this rate: %u entries, ~%u erases per sector\n", day_entries,
+               (day_entries / 126 + sectors - 1) / sectors);
+    }
+    return 0;
+}
+
+/* moves [n]: move record as CSV */
+static int cmd_moves(int argc, char **argv)
+{
+    uint32_t max_moves = (argc > 1) ? strtoul(argv[1], NULL, 10) : 0;
+
+    /* Moves of a running game may still be in RAM */
+    gamelog_stats_t g;
+    gamelog_flush();
+    for (int i = 0; i < 200; i++) {
+        gamelog_get_stats(&g);
+        if (g.pending == 0) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    gamelog_dump_csv(stdout, max_moves);
+    gamelog_get_stats(&g);
+    printf("# recorded %u, flushed %u, pending %u, dropped %u, failed writes %u\n", (unsigned)g.recorded,
+           (unsigned)g.flushed, (unsigned)g.pending, (unsigned)g.dropped, (unsigned)g.failed);
+    return 0;
+}
+
+/* display: LVGL refresh rate and timing since the previous call */
+static int cmd_display(int argc, char **argv)
+{
+    lcd_stats_t d;
+    lcd_get_stats(&d);
+    if (d.frames == 0) {
+        printf("no refresh in %u ms\n", (unsigned)(d.interval_us / 1000));
+        return 0;
+    }
+
+    printf("frames       %6u in %u ms, %u.%u fps\n", (unsigned)d.frames, (unsigned)(d.interval_us / 1000),
+           (unsigned)(d.frames * 10000000ULL / d.interval_us / 10), (unsigned)(d.frames * 10000000ULL / d.interval_us % 10));
+    printf("refresh      %6u us avg, %u ms max\n", (unsigned)(d.refresh_us / d.frames), (unsigned)d.refresh_max_ms);
+    printf("flush wait   %6u us avg, %u %% of refresh\n", (unsigned)(d.wait_us / d.frames),
+           d.refresh_us ? (unsigned)(d.wait_us * 100 / d.refresh_us) : 0);
+    printf("per frame    %6u px in %u.%u areas\n", (unsigned)(d.pixels / d.frames),
+           (unsigned)(d.flushes / d.frames), (unsigned)(d.flushes * 10 / d.frames % 10));
+    return 0;
+}
+
+/* calib [pulse <s> [period_ms] | rtc <s> | set <ppb> | stop]: timebase correction and drift */
+static int cmd_calib(int argc, char **argv)
+{
+    esp_err_t ret = ESP_OK;
+    if (argc > 2 && strcmp(argv[1], "pulse") == 0) {
+        uint32_t period_ms = (argc > 3) ? strtoul(argv[3], NULL, 10) : CONFIG_CHESS_CALIB_PPS_PERIOD_MS;
+        ret = calib_start(CalibRefPulse, strtoul(argv[2], NULL, 10), (int64_t)period_ms * 1000);
+    }
+    else if (argc > 2 && strcmp(argv[1], "rtc") == 0) {
+        ret = calib_start(CalibRefRtc, strtoul(argv[2], NULL, 10), 0);
+    }
+    else if (argc > 2 && strcmp(argv[1], "set") == 0) {
+        calib_stop();
+        ret = calib_set_ppb(strtol(argv[2], NULL, 10));
+    }
+    else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        calib_stop();
+    }
+    else if (argc > 1) {
+        printf("Unknown arguments\n");
+        return 1;
+    }
+    if (ret != ESP_OK) {
+        printf("%s\n", esp_err_to_name(ret));
+        return 1;
+    }
+
+    calib_stats_t c;
+    calib_get_stats(&c);
+    printf("correction   %+ld ppb, %+ld ms per 2 h\n", (long)c.ppb, (long)((int64_t)c.ppb * 72 / 10000));
+    if (c.running != CalibRefNone) {
+        printf("measuring    %s, %u s left\n", (c.running == CalibRefPulse) ? "pulse" : "rtc",
+               (unsigned)((c.remaining_us + 999999) / 1000000));
+    }
+
+    const drift_t *d = &c.pulse;
+    int32_t raw_ppb;
+    printf("pulse        %u periods of %u ms over %u s, %u rejected, jitter %u us\n", (unsigned)d->intervals,
+           (unsigned)(d->period_us / 1000), (unsigned)((d->last_us - d->first_us) / 1000000),
+           (unsigned)d->rejected, (unsigned)d->jitter_us);
+    if (drift_ppb(d, &raw_ppb)) {
+        printf("drift        raw %+ld ppb, applied %+ld ppb, residual %+ld ppb\n", (long)raw_ppb,
+               (long)c.pulse_applied_ppb, (long)(raw_ppb - c.pulse_applied_ppb));
+    }
+    if (c.rtc_span_us) {
+        printf("rtc          %+ld ppb over %u s\n", (long)c.rtc_ppb, (unsigned)(c.rtc_span_us / 1000000));
+    }
+    return 0;
+}
+
+static const esp_console_cmd_t commands[] = {
+    {
+        .command = "latency",
+        .help = "Press-to-photon latency per stage, measured from the press edge. 'reset' clears it",
+        .hint = "[reset]",
+        .func = cmd_latency,
+    },
+    {
+        .command = "tasks",
+        .help = "Task priority, CPU share since the previous call and free stack [bytes], input ring and heap usage",
+        .hint = NULL,
+        .func = cmd_tasks,
+    },
+    {
+        .command = "power",
+        .help = "Time with a clock running, awake and in light sleep, wake-ups and estimated SoC current",
+        .hint = NULL,
+        .func = cmd_power,
+    },
+    {
+        .command = "boot",
+        .help = "Boot timeline, time of each init stage since start",
+        .hint = NULL,
+        .func = cmd_boot,
+    },
+    {
+        .command = "journal",
+        .help = "Game state checkpoints written to NVS and projected flash wear",
+        .hint = NULL,
+        .func = cmd_journal,
+    },
+    {
+        .command = "moves",
+        .help = "Recorded moves as CSV, oldest first, optionally only the last n",
+        .hint = "[n]",
+        .func = cmd_moves,
+    },
+    {
+        .command = "display",
+        .help = "LVGL refreshes per second, refresh time and time blocked on LCD transfers since the previous call",
+        .hint = NULL,
+        .func = cmd_display,
+    },
+    {
+        .command = "calib",
+        .help = "Timebase correction and drift against the reference pulses. 'pulse' or 'rtc' measures for s seconds and stores the result",
+        .hint = "[pulse <s> [period_ms] | rtc <s> | set <ppb> | stop]",
+        .func = cmd_calib,
+    },
+};
+
+esp_err_t console_init(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "clock>";
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ESP_RETURN_ON_ERROR(esp_console_new_repl_uart(&uart_config, &repl_config, &repl), TAG, "REPL create failed");
+
+    ESP_RETURN_ON_ERROR(esp_console_register_help_command(), TAG, "Help register failed");
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        ESP_RETURN_ON_ERROR(esp_console_cmd_register(&commands[i]), TAG, "%s register failed", commands[i].command);
+    }
+    return esp_console_start_repl(repl);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "esp_err.h"
+
+/**
+ * Serial console
+ *
+ * esp_console REPL on the default console UART with diagnostic commands, type 'help' for
+ * the list.
+ */
+
+/**
+ * @brief Register commands and start the REPL task
+ */
+esp_err_t console_init(void);
@@ -0,0 +1,63 @@
+#include "debounce.h"
+
+void debounce_init(debounce_t *db)
+{
+    db->state = DebounceReleased;
+    db->edge_us = 0;
+    db->level_us = 0;
+    db->glitches = 0;
+}
+
+bool debounce_sample(debounce_t *db, bool pressed, int64_t now_us, int64_t *press_us)
+{
+    switch (db->state) {
+    case DebounceReleased:
+        if (pressed) {
+            db->state = DebouncePressPending;
+            db->edge_us = now_us;
+            db->level_us = now_us;
+        }
+        break;
+
+    case DebouncePressPending:
+        if (!pressed) {
+            db->state = DebouncePressBounce;
+            db->level_us = now_us;
+            db->glitches++;
+        }
+        else if (now_us - db->level_us >= DEBOUNCE_US) {
+            db->state = DebouncePressed;
+            *press_us = db->edge_us;
+            return true;
+        }
+        break;
+
+    case DebouncePressBounce:
+        if (pressed) {
+            db->state = DebouncePressPending;   // Same press, edge_us stays
+            db->level_us = now_us;
+        }
+        else if (now_us - db->level_us >= DEBOUNCE_US) {
+            db->state = DebounceReleased;
+        }
+        break;
+
+    case DebouncePressed:
+        if (!pressed) {
+            db->state = DebounceReleasePending;
+            db->level_us = now_us;
+        }
+        break;
+
+    case DebounceReleasePending:
+        if (pressed) {
+            db->state = DebouncePressed;
+            db->glitches++;
+        }
+        else if (now_us - db->level_us >= DEBOUNCE_US) {
+            db->state = DebounceReleased;
+        }
+        break;
+    }
+    return false;
+}
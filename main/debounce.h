@@ -0,0 +1,46 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Button debouncer
+ *
+ * Per-button state machine fed with periodic level samples. A level change is accepted once it
+ * has been stable for DEBOUNCE_US, a press is then reported with the timestamp of its first
+ * edge, so bouncing and sampling delay are not charged to the player. A press that bounces back
+ * to released for less than DEBOUNCE_US keeps its first edge.
+ *
+ * The debouncer has no dependency on FreeRTOS or BSP.
+ */
+
+#define DEBOUNCE_US     (20 * 1000)     // Minimum stable time of a new level
+
+typedef enum {
+    DebounceReleased,
+    DebouncePressPending,   // Pressed level seen, waiting to be stable
+    DebouncePressBounce,    // Pending press bounced back, a press within DEBOUNCE_US continues it
+    DebouncePressed,
+    DebounceReleasePending, // Released level seen, waiting to be stable
+} debounce_state_t;
+
+typedef struct {
+    debounce_state_t state;
+    int64_t edge_us;        // First edge of the pending press
+    int64_t level_us;       // Last level change, the level must stay for DEBOUNCE_US
+    uint32_t glitches;      // Level changes rejected as bounces
+} debounce_t;
+
+/**
+ * @brief Initialize debouncer in released state
+ */
+void debounce_init(debounce_t *db);
+
+/**
+ * @brief Feed one level sample
+ *
+ * @param pressed Sampled button level
+ * @param now_us Sample timestamp
+ * @param[out] press_us Timestamp of the press edge, valid when true is returned
+ * @return true when a press has been confirmed
+ */
+bool debounce_sample(debounce_t *db, bool pressed, int64_t now_us, int64_t *press_us);
@@ -0,0 +1,158 @@
+#include "digit_cache.h"
+#include "esp_heap_caps.h"
+
+static lv_img_dsc_t sprites[DIGIT_SPRITE_NUM];
+static lv_coord_t digit_w;
+static lv_coord_t separator_w;
+static lv_coord_t cell_h;
+
+static lv_coord_t glyph_adv(const lv_font_t *font, uint32_t letter)
+{
+    lv_font_glyph_dsc_t g;
+    return lv_font_get_glyph_dsc(font, &g, letter, 0) ? g.adv_w : 0;
+}
+
+/* Render one glyph centered into an 8-bit alpha cell of cell_w x h */
+static void render_glyph(const lv_font_t *font, uint32_t letter, lv_coord_t cell_w, lv_coord_t h, lv_img_dsc_t *img)
+{
+    size_t size = (size_t)cell_w * h;
+    uint8_t *buf = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM);
+    if (buf == NULL) {
+        buf = heap_caps_calloc(1, size, MALLOC_CAP_8BIT);
+    }
+    assert(buf != NULL);
+
+    lv_font_glyph_dsc_t g;
+    const uint8_t *bitmap = NULL;
+    if (lv_font_get_glyph_dsc(font, &g, letter, 0)) {
+        bitmap = lv_font_get_glyph_bitmap(font, letter);
+    }
+
+    if (bitmap != NULL) {
+        const uint32_t mask = (1 << g.bpp) - 1;
+        const lv_coord_t x0 = (cell_w - g.adv_w) / 2 + g.ofs_x;
+        const lv_coord_t y0 = font->line_height - font->base_line - g.box_h - g.ofs_y;
+
+        /* Glyph bitmaps are packed continuously, g.bpp bits per pixel, MSB first */
+        for (lv_coord_t y = 0; y < g.box_h; y++) {
+            for (lv_coord_t x = 0; x < g.box_w; x++) {
+                lv_coord_t cx = x0 + x;
+                lv_coord_t cy = y0 + y;
+                if (cx < 0 || cx >= cell_w || cy < 0 || cy >= h) {
+                    continue;
+                }
+                uint32_t bit = ((uint32_t)y * g.box_w + x) * g.bpp;
+                uint32_t value = (bitmap[bit >> 3] >> (8 - g.bpp - (bit & 7))) & mask;
+                buf[cy * cell_w + cx] = (uint8_t)(value * 255 / mask);
+            }
+        }
+    }
+
+    img->header.always_zero = 0;
+    img->header.cf = LV_IMG_CF_ALPHA_8BIT;
+    img->header.w = cell_w;
+    img->header.h = h;
+    img->data_size = size;
+    img->data = buf;
+}
+
+void digit_cache_init(const lv_font_t *font)
+{
+    cell_h = font->line_height;
+
+    digit_w = 0;
+    for (uint32_t d = 0; d < 10; d++) {
+        lv_coord_t adv = glyph_adv(font, '0' + d);
+        if (adv > digit_w) {
+            digit_w = adv;
+        }
+    }
+    separator_w = glyph_adv(font, ':') + 2 * glyph_adv(font, ' ');
+
+    for (uint32_t d = 0; d < 10; d++) {
+        render_glyph(font, '0' + d, digit_w, cell_h, &sprites[d]);
+    }
+    render_glyph(font, ':', separator_w, cell_h, &sprites[DIGIT_SEPARATOR]);
+    render_glyph(font, '.', separator_w, cell_h, &sprites[DIGIT_POINT]);
+    render_glyph(font, ' ', digit_w, cell_h, &sprites[DIGIT_BLANK]);
+}
+
+const lv_img_dsc_t *digit_cache_get(unsigned int index)
+{
+    assert(index < DIGIT_SPRITE_NUM);
+    return &sprites[index];
+}
+
+lv_coord_t digit_cache_digit_width(void)
+{
+    return digit_w;
+}
+
+lv_coord_t digit_cache_separator_width(void)
+{
+    return separator_w;
+}
+
+lv_coord_t digit_cache_height(void)
+{
+    return cell_h;
+}
+
+#if CONFIG_CHESS_FONT_BENCH
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define BENCH_ROUNDS    (20)
+
+static const char *TAG = "digit_cache";
+
+/* Flash taken by a font in the LVGL built-in format: glyph descriptors and bitmaps */
+static size_t font_size(const lv_font_t *font, uint32_t *glyphs)
+{
+    const lv_font_fmt_txt_dsc_t *dsc = font->dsc;
+    uint32_t n = 1;     // Glyph 0 is reserved
+    for (uint32_t i = 0; i < dsc->cmap_num; i++) {
+        const lv_font_fmt_txt_cmap_t *cmap = &dsc->cmaps[i];
+        uint32_t end = cmap->glyph_id_start + (cmap->list_length ? cmap->list_length : cmap->range_length);
+        n = (end > n) ? end : n;
+    }
+    const lv_font_fmt_txt_glyph_dsc_t *last = &dsc->glyph_dsc[n - 1];
+    *glyphs = n - 1;
+    return last->bitmap_index + (last->box_w * last->box_h * dsc->bpp + 7) / 8 +
+           n * sizeof(lv_font_fmt_txt_glyph_dsc_t);
+}
+
+void digit_cache_benchmark(const lv_font_t *font, const char *name)
+{
+    /* Glyph decoding is paid for every character of a label drawn with the font */
+    int64_t start = esp_timer_get_time();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (uint32_t letter = '0'; letter <= ':'; letter++) {
+            lv_font_get_glyph_bitmap(font, letter);
+        }
+    }
+    int64_t decode_us = (esp_timer_get_time() - start) / BENCH_ROUNDS;
+
+    /* The sprites are rasterized once, after that a readout update only swaps images */
+    lv_coord_t w = 0;
+    for (uint32_t d = 0; d < 10; d++) {
+        lv_coord_t adv = glyph_adv(font, '0' + d);
+        w = (adv > w) ? adv : w;
+    }
+    size_t sprite_bytes = 0;
+    start = esp_timer_get_time();
+    for (uint32_t letter = '0'; letter <= ':'; letter++) {
+        lv_img_dsc_t img;
+        render_glyph(font, letter, w, font->line_height, &img);
+        sprite_bytes += img.data_size;
+        heap_caps_free((void *)img.data);
+    }
+    int64_t raster_us = esp_timer_get_time() - start;
+
+    uint32_t glyphs;
+    size_t size = font_size(font, &glyphs);
+    ESP_LOGI(TAG, "%s: %d px line, %u glyphs in ~%u bytes, decode %d us per 11 glyphs, "
+             "sprites %d us, %u bytes", name, font->line_height, (unsigned)glyphs, (unsigned)size,
+             (int)decode_us, (int)raster_us, (unsigned)sprite_bytes);
+}
+#endif
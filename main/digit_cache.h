@@ -0,0 +1,50 @@
+#pragma once
+#include "lvgl.h"
+
+/**
+ * Pre-rendered digit sprites for the time readouts
+ *
+ * Digits 0-9, the separators and a blank cell are rasterized once into 8-bit alpha images, so a readout
+ * update is only an image source swap of the digits that changed. The color is given by the
+ * img_recolor style of the image widget.
+ */
+
+#define DIGIT_SEPARATOR     (10)    // Sprite index of the " : " separator
+#define DIGIT_POINT         (11)    // Decimal point, same cell width as the separator
+#define DIGIT_BLANK         (12)    // Empty digit cell
+#define DIGIT_SPRITE_NUM    (13)
+
+/**
+ * @brief Rasterize digit sprites from font
+ *
+ * Sprites are placed in PSRAM when available. All digits share one cell width, so the
+ * readout does not move when the time changes.
+ */
+void digit_cache_init(const lv_font_t *font);
+
+/**
+ * @brief Log glyph data size, glyph decode time and sprite rasterization time of a font
+ *
+ * Only with CONFIG_CHESS_FONT_BENCH, fonts must be in the LVGL built-in format.
+ */
+void digit_cache_benchmark(const lv_font_t *font, const char *name);
+
+/**
+ * @brief Get sprite of digit 0-9, DIGIT_SEPARATOR, DIGIT_POINT or DIGIT_BLANK
+ */
+const lv_img_dsc_t *digit_cache_get(unsigned int index);
+
+/**
+ * @brief Width of the digit cell [px]
+ */
+lv_coord_t digit_cache_digit_width(void);
+
+/**
+ * @brief Width of the separator cell [px]
+ */
+lv_coord_t digit_cache_separator_width(void);
+
+/**
+ * @brief Height of all sprites [px]
+ */
+lv_coord_t digit_cache_height(void);
@@ -7,16 +7,150 @@
 #include "disp.h"
 #include "lvgl.h"
 #include "bsp/esp-bsp.h"
+#include "digit_cache.h"
+
+/* Time readout cells: M M : S S, or S S . t under CLOCK_TENTHS_BELOW_MS */
+#define TIME_CELLS      (5)
+#define TIME_SEP_CELL   (2)
+
+/* Screen space kept for the title and time control above and the button legend below */
+#define LAYOUT_TOP      (54)
+#define LAYOUT_BOTTOM   (24)
+#define LAYOUT_GAP      (6)
+#define BAR_WIDTH_MAX   (50)
+
+/* Digits only font generated at build time (see main/CMakeLists.txt), the stock one otherwise */
+#if CONFIG_CHESS_DIGIT_FONT
+LV_FONT_DECLARE(clock_digits);
+#define TIME_FONT       (&clock_digits)
+#else
+#define TIME_FONT       (&lv_font_montserrat_24)
+#endif
 
 static lv_obj_t *clk1_bar = NULL;
 static lv_obj_t *clk2_bar = NULL;
-static lv_obj_t *clk1_time_spangroup = NULL;
-static lv_obj_t *clk2_time_spangroup = NULL;
-static lv_span_t *clk1_time_span = NULL;
-static lv_span_t *clk2_time_span = NULL;
+static lv_obj_t *clk1_time_box = NULL;
+static lv_obj_t *clk2_time_box = NULL;
+static lv_obj_t *control_label = NULL;
+static lv_obj_t *time_cells[2][TIME_CELLS];
 static lv_style_t clk1_border_style;
 static lv_style_t clk2_border_style;
 
+/* Last rendered values, used to skip widgets that did not change */
+static struct {
+    bool valid;
+    unsigned int max_sec;
+    unsigned int sec[2];
+    unsigned int shown[2];      // Seconds or tenths in the readout
+    bool tenths[2];
+    uint8_t digits[2][TIME_CELLS];
+    bool active[2];
+    uint8_t control;
+} rendered;
+
+static lv_coord_t time_readout_width(void)
+{
+    return 4 * digit_cache_digit_width() + digit_cache_separator_width() + 16;
+}
+
+static lv_coord_t time_readout_height(void)
+{
+    return digit_cache_height() + 6;
+}
+
+/* Create bordered time readout made of digit sprite images */
+static lv_obj_t *time_readout_create(lv_style_t *border_style, lv_obj_t *cells[TIME_CELLS])
+{
+    const lv_coord_t digit_w = digit_cache_digit_width();
+    const lv_coord_t sep_w = digit_cache_separator_width();
+
+    lv_obj_t *box = lv_obj_create(lv_scr_act());
+    lv_obj_remove_style_all(box);
+    lv_obj_add_style(box, border_style, 0);
+    lv_obj_clear_flag(box, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_size(box, time_readout_width(), time_readout_height());
+
+    lv_coord_t x = 6;
+    for (int i = 0; i < TIME_CELLS; i++) {
+        cells[i] = lv_img_create(box);
+        lv_obj_set_style_img_recolor(cells[i], lv_color_black(), 0);
+        lv_obj_set_style_img_recolor_opa(cells[i], LV_OPA_COVER, 0);
+        lv_img_set_src(cells[i], digit_cache_get(i == TIME_SEP_CELL ? DIGIT_SEPARATOR : 0));
+        lv_obj_set_pos(cells[i], x, 1);
+        x += (i == TIME_SEP_CELL) ? sep_w : digit_w;
+    }
+    return box;
+}
+
+/* Readouts side by side above the button legend when they fit, otherwise stacked in the middle
+   with the bars at the screen edges. The bars take the height that is left. */
+static void layout(void)
+{
+    const lv_coord_t hor = lv_disp_get_hor_res(NULL);
+    const lv_coord_t ver = lv_disp_get_ver_res(NULL);
+    const lv_coord_t box_w = time_readout_width();
+    const lv_coord_t box_h = time_readout_height();
+    const lv_coord_t avail_h = ver - LAYOUT_TOP - LAYOUT_BOTTOM;
+
+    if (2 * box_w + 3 * LAYOUT_GAP <= hor) {
+        lv_coord_t margin = (hor - 2 * box_w) / 3;
+        margin = (margin > 10) ? 10 : margin;
+        lv_obj_align(clk1_time_box, LV_ALIGN_BOTTOM_LEFT, margin, -LAYOUT_BOTTOM);
+        lv_obj_align(clk2_time_box, LV_ALIGN_BOTTOM_RIGHT, -margin, -LAYOUT_BOTTOM);
+
+        lv_coord_t bar_h = avail_h - box_h - 2 * LAYOUT_GAP;
+        lv_obj_set_size(clk1_bar, BAR_WIDTH_MAX, bar_h);
+        lv_obj_set_size(clk2_bar, BAR_WIDTH_MAX, bar_h);
+        lv_obj_align(clk1_bar, LV_ALIGN_TOP_MID, -60, LAYOUT_TOP);
+        lv_obj_align(clk2_bar, LV_ALIGN_TOP_MID, 60, LAYOUT_TOP);
+    }
+    else {
+        lv_coord_t y = LAYOUT_TOP + (avail_h - 2 * box_h - LAYOUT_GAP) / 2;
+        lv_obj_align(clk1_time_box, LV_ALIGN_TOP_MID, 0, y);
+        lv_obj_align(clk2_time_box, LV_ALIGN_TOP_MID, 0, y + box_h + LAYOUT_GAP);
+
+        lv_coord_t bar_w = (hor - box_w) / 2 - 2 * LAYOUT_GAP;
+        bar_w = (bar_w > BAR_WIDTH_MAX) ? BAR_WIDTH_MAX : bar_w;
+        lv_obj_set_size(clk1_bar, bar_w, avail_h - LAYOUT_GAP);
+        lv_obj_set_size(clk2_bar, bar_w, avail_h - LAYOUT_GAP);
+        lv_obj_align(clk1_bar, LV_ALIGN_TOP_LEFT, LAYOUT_GAP, LAYOUT_TOP);
+        lv_obj_align(clk2_bar, LV_ALIGN_TOP_RIGHT, -LAYOUT_GAP, LAYOUT_TOP);
+    }
+}
+
+/* Swap only the digit sprites that differ from the rendered ones, so a tenth of a second
+   redraws a single cell */
+static void set_time_digits(int player, unsigned int shown, bool tenths)
+{
+    uint8_t digits[TIME_CELLS];
+    if (tenths) {
+        unsigned int sec = shown / 10;
+        digits[0] = (sec >= 10) ? sec / 10 : DIGIT_BLANK;
+        digits[1] = sec % 10;
+        digits[2] = DIGIT_POINT;
+        digits[3] = shown % 10;
+        digits[4] = DIGIT_BLANK;
+    }
+    else {
+        unsigned int min = shown / 60;
+        if (min > 99) {
+            min = 99;   // Two minute digits only
+        }
+        digits[0] = min / 10;
+        digits[1] = min % 10;
+        digits[2] = DIGIT_SEPARATOR;
+        digits[3] = (shown % 60) / 10;
+        digits[4] = shown % 10;
+    }
+
+    for (int i = 0; i < TIME_CELLS; i++) {
+        if (!rendered.valid || digits[i] != rendered.digits[player][i]) {
+            lv_img_set_src(time_cells[player][i], digit_cache_get(digits[i]));
+            rendered.digits[player][i] = digits[i];
+        }
+    }
+}
+
 
 void disp_init(void)
 {
@@ -37,48 +171,33 @@ void disp_init(void)
 
     lv_spangroup_refr_mode(spans);
 
+    // Time control name
+    control_label = lv_label_create(lv_scr_act());
+    lv_label_set_text(control_label, "");
+    lv_obj_align(control_label, LV_ALIGN_TOP_MID, 0, 34);
+
     
     // Clock 1 Time
+    digit_cache_init(TIME_FONT);
+#if CONFIG_CHESS_FONT_BENCH
+    digit_cache_benchmark(&lv_font_montserrat_24, "montserrat 24");
+    digit_cache_benchmark(TIME_FONT, "readout");
+#endif
+
     lv_style_init(&clk1_border_style);
     lv_style_set_border_width(&clk1_border_style, 2);
     lv_style_set_radius(&clk1_border_style, 10);
     lv_style_set_border_color(&clk1_border_style, lv_palette_lighten(LV_PALETTE_BLUE, 4));
-    // lv_style_set_pad_all(&clk1_border_style, 2);
 
-    clk1_time_spangroup = lv_spangroup_create(lv_scr_act());
-    lv_obj_set_size(clk1_time_spangroup, 100, 30);
-    lv_obj_align(clk1_time_spangroup, LV_ALIGN_BOTTOM_LEFT, 10, -35);
-
-    lv_obj_add_style(clk1_time_spangroup, &clk1_border_style, 0);
-    lv_spangroup_set_align(clk1_time_spangroup, LV_TEXT_ALIGN_CENTER);
-    lv_spangroup_set_overflow(clk1_time_spangroup, LV_SPAN_OVERFLOW_CLIP);
-    lv_spangroup_set_mode(clk1_time_spangroup, LV_SPAN_MODE_FIXED);
-
-    clk1_time_span = lv_spangroup_new_span(clk1_time_spangroup);
-    lv_span_set_text(clk1_time_span, "01 : 00");
-    lv_style_set_text_font(&clk1_time_span->style,  &lv_font_montserrat_24);
-    lv_spangroup_refr_mode(clk1_time_spangroup);
+    clk1_time_box = time_readout_create(&clk1_border_style, time_cells[Player1]);
 
     // Clock 2 Time
     lv_style_init(&clk2_border_style);
     lv_style_set_border_width(&clk2_border_style, 2);
     lv_style_set_radius(&clk2_border_style, 10);
     lv_style_set_border_color(&clk2_border_style, lv_palette_lighten(LV_PALETTE_RED, 4));
-    // lv_style_set_pad_all(&clk2_border_style, 2);
-
-    clk2_time_spangroup = lv_spangroup_create(lv_scr_act());
-    lv_obj_set_size(clk2_time_spangroup, 100, 30);
-    lv_obj_align(clk2_time_spangroup, LV_ALIGN_BOTTOM_RIGHT, -10, -35);
 
-    lv_obj_add_style(clk2_time_spangroup, &clk2_border_style, 0);
-    lv_spangroup_set_align(clk2_time_spangroup, LV_TEXT_ALIGN_CENTER);
-    lv_spangroup_set_overflow(clk2_time_spangroup, LV_SPAN_OVERFLOW_CLIP);
-    lv_spangroup_set_mode(clk2_time_spangroup, LV_SPAN_MODE_FIXED);
-
-    clk2_time_span = lv_spangroup_new_span(clk2_time_spangroup);
-    lv_span_set_text(clk2_time_span, "01 : 00");
-    lv_style_set_text_font(&clk2_time_span->style,  &lv_font_montserrat_24);
-    lv_spangroup_refr_mode(clk2_time_spangroup);
+    clk2_time_box = time_readout_create(&clk2_border_style, time_cells[Player2]);
 
     
     // Player 1 bar
@@ -93,10 +212,8 @@ void disp_init(void)
     lv_style_set_bg_color(&clk1_style_indic, lv_palette_main(LV_PALETTE_BLUE));
     
     clk1_bar = lv_bar_create(lv_scr_act());
-    lv_obj_set_size(clk1_bar, 50, 200);
     lv_obj_add_style(clk1_bar, &clk1_style_bg, 0);
     lv_obj_add_style(clk1_bar, &clk1_style_indic, LV_PART_INDICATOR);
-    lv_obj_align(clk1_bar, LV_ALIGN_CENTER, -60, -20);
     lv_bar_set_range(clk1_bar, 0, 60);
     lv_bar_set_value(clk1_bar, 60, LV_ANIM_OFF);
 
@@ -112,13 +229,13 @@ void disp_init(void)
     lv_style_set_bg_color(&clk2_style_indic, lv_palette_main(LV_PALETTE_RED));
 
     clk2_bar = lv_bar_create(lv_scr_act());
-    lv_obj_set_size(clk2_bar, 50, 200);
     lv_obj_add_style(clk2_bar, &clk2_style_bg, 0);
     lv_obj_add_style(clk2_bar, &clk2_style_indic, LV_PART_INDICATOR);
-    lv_obj_align(clk2_bar, LV_ALIGN_CENTER, 60, -20);
     lv_bar_set_range(clk2_bar, 0, 60);
     lv_bar_set_value(clk2_bar, 60, LV_ANIM_OFF);
 
+    layout();
+
 
     // buttons label
     lv_obj_t * buttons_label = lv_label_create(lv_scr_act());
@@ -130,60 +247,53 @@ void disp_init(void)
     bsp_display_unlock();
 }
 
-void disp_set_clock1(unsigned int max_time, unsigned int P1_sec)
+void disp_update(const clock_view_t *view)
 {
-    assert(clk1_bar);
-    
-    char str[20];
-    sprintf(str, "%02d : %02d", P1_sec/60, P1_sec%60);
-    
-    bsp_display_lock(0);
+    assert(clk1_bar && clk2_bar);
 
-    lv_bar_set_range(clk1_bar, 0, max_time);
-    lv_bar_set_value(clk1_bar, P1_sec, LV_ANIM_OFF);
-    lv_span_set_text(clk1_time_span, str);
-    lv_spangroup_refr_mode(clk1_time_spangroup);
+    lv_obj_t *bars[2] = { clk1_bar, clk2_bar };
+    lv_obj_t *boxes[2] = { clk1_time_box, clk2_time_box };
+    const lv_palette_t palettes[2] = { LV_PALETTE_BLUE, LV_PALETTE_RED };
 
-    bsp_display_unlock();
-}
+    unsigned int max_sec = clock_display_sec(view->set_time_ms);
 
-void disp_set_clock2(unsigned int max_time, unsigned int P2_sec)
-{
-    assert(clk2_bar);
-    
-    char str[20];
-    sprintf(str, "%02d : %02d", P2_sec/60, P2_sec%60);
-    
     bsp_display_lock(0);
 
-    lv_bar_set_range(clk2_bar, 0, max_time);
-    lv_bar_set_value(clk2_bar, P2_sec, LV_ANIM_OFF);
-    lv_span_set_text(clk2_time_span, str);
-    lv_spangroup_refr_mode(clk2_time_spangroup);
-
-    bsp_display_unlock();
-}
+    if (!rendered.valid || max_sec != rendered.max_sec) {
+        lv_bar_set_range(clk1_bar, 0, max_sec);
+        lv_bar_set_range(clk2_bar, 0, max_sec);
+        rendered.max_sec = max_sec;
+    }
 
-void disp_set_P1_cb(bool set)
-{
-    bsp_display_lock(0);
-    if (set) {
-        lv_style_set_border_color(&clk1_border_style, lv_palette_main(LV_PALETTE_BLUE));
-    } else {
-        lv_style_set_border_color(&clk1_border_style, lv_palette_lighten(LV_PALETTE_BLUE, 4));
+    if (!rendered.valid || view->control != rendered.control) {
+        lv_label_set_text(control_label, time_controls[view->control].name);
+        rendered.control = view->control;
     }
-    lv_spangroup_refr_mode(clk1_time_spangroup);
-    bsp_display_unlock();
-}
 
-void disp_set_P2_cb(bool set)
-{
-    bsp_display_lock(0);
-    if (set) {
-        lv_style_set_border_color(&clk2_border_style, lv_palette_main(LV_PALETTE_RED));
-    } else {
-        lv_style_set_border_color(&clk2_border_style, lv_palette_lighten(LV_PALETTE_RED, 4));
+    for (int p = Player1; p <= Player2; p++) {
+        uint32_t ms = view->remaining_ms[p];
+        unsigned int sec = clock_display_sec(ms);
+        if (!rendered.valid || sec != rendered.sec[p]) {
+            lv_bar_set_value(bars[p], sec, LV_ANIM_OFF);
+            rendered.sec[p] = sec;
+        }
+
+        bool tenths = (ms < CLOCK_TENTHS_BELOW_MS);
+        unsigned int shown = tenths ? clock_display_tenths(ms) : sec;
+        if (!rendered.valid || shown != rendered.shown[p] || tenths != rendered.tenths[p]) {
+            set_time_digits(p, shown, tenths);
+            rendered.shown[p] = shown;
+            rendered.tenths[p] = tenths;
+        }
+
+        bool active = (view->state == Playing && view->active_player == (enum Players)p);
+        if (!rendered.valid || active != rendered.active[p]) {
+            lv_color_t color = active ? lv_palette_main(palettes[p]) : lv_palette_lighten(palettes[p], 4);
+            lv_obj_set_style_border_color(boxes[p], color, 0);
+            rendered.active[p] = active;
+        }
     }
-    lv_spangroup_refr_mode(clk2_time_spangroup);
+    rendered.valid = true;
+
     bsp_display_unlock();
 }
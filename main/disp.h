@@ -6,6 +6,7 @@
 
 #pragma once
 #include <stdbool.h>
+#include "clock.h"
 
 /**
  * @brief Example: Create basic graphics widgets
@@ -13,9 +14,11 @@
  */
 void disp_init(void);
 
-void disp_set_clock1(unsigned int max_time, unsigned int P1_sec);
-void disp_set_clock2(unsigned int max_time, unsigned int P2_sec);
-
-void disp_set_P1_cb(bool set);
-
-void disp_set_P2_cb(bool set);
+/**
+ * @brief Render clock snapshot
+ *
+ * Takes the display lock once and updates only the widgets whose value changed since the
+ * previous call (time readouts, bars, active player borders). Readouts switch to tenths of a
+ * second below CLOCK_TENTHS_BELOW_MS.
+ */
+void disp_update(const clock_view_t *view);
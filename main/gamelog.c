@@ -0,0 +1,278 @@
+#include <stdatomic.h>
+#include <string.h>
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "alloc.h"
+#include "gamelog.h"
+
+#define RING_MASK           (GAMELOG_RING_SIZE - 1)
+#define RING_FLUSH_LEVEL    (GAMELOG_RING_SIZE * 3 / 4)     // Flush while playing above this
+#define SECTOR_SIZE         (4096)
+#define SECTOR_SLOTS        (SECTOR_SIZE / sizeof(move_record_t))   // Slot 0 is the sector header
+#define SECTOR_MAGIC        (0x474C4732)                            // "GLG2", record with increment_ms
+#define BATCH_RECORDS       (64)
+
+_Static_assert(sizeof(move_record_t) == 16, "Move record must stay 16 bytes");
+
+/* First slot of every log sector */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               // Incremented with every new sector
+    uint32_t reserved[2];
+} sector_header_t;
+
+static const char *TAG = "gamelog";
+static const esp_partition_t *part;
+static unsigned int sectors;
+static SemaphoreHandle_t log_lock;  // Flash log position, flush task vs. dump
+static TaskHandle_t flush_handle;
+
+/* Flash log position, cur_sector < 0 before the first sector is opened */
+static int cur_sector = -1;
+static unsigned int cur_slot;
+static uint32_t cur_seq;
+
+/* Single producer (clock task) / single consumer (flush task) ring in PSRAM */
+static move_record_t *ring;
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+static volatile uint32_t recorded;
+static volatile uint32_t dropped;
+static volatile uint32_t flushed;
+static volatile uint32_t failed;
+
+static bool slot_erased(const move_record_t *r)
+{
+    return r->time_ms == UINT32_MAX && r->move == 0x7FFF;
+}
+
+static bool sector_header_read(unsigned int sector, sector_header_t *hdr)
+{
+    return esp_partition_read(part, sector * SECTOR_SIZE, hdr, sizeof(*hdr)) == ESP_OK &&
+           hdr->magic == SECTOR_MAGIC;
+}
+
+/* Find the newest sector and the first free slot in it */
+static void log_find_end(void)
+{
+    for (unsigned int s = 0; s < sectors; s++) {
+        sector_header_t hdr;
+        if (sector_header_read(s, &hdr) && (cur_sector < 0 || hdr.seq > cur_seq)) {
+            cur_sector = s;
+            cur_seq = hdr.seq;
+        }
+    }
+    if (cur_sector < 0) {
+        return;
+    }
+
+    move_record_t r;
+    for (cur_slot = 1; cur_slot < SECTOR_SLOTS; cur_slot++) {
+        esp_partition_read(part, cur_sector * SECTOR_SIZE + cur_slot * sizeof(r), &r, sizeof(r));
+        if (slot_erased(&r)) {
+            break;
+        }
+    }
+}
+
+static esp_err_t log_open_sector(void)
+{
+    unsigned int sector = (cur_sector < 0) ? 0 : (cur_sector + 1) % sectors;
+    ESP_RETURN_ON_ERROR(esp_partition_erase_range(part, sector * SECTOR_SIZE, SECTOR_SIZE), TAG, "Erase failed");
+
+    sector_header_t hdr = {
+        .magic = SECTOR_MAGIC,
+        .seq = (cur_sector < 0) ? 0 : cur_seq + 1,
+    };
+    ESP_RETURN_ON_ERROR(esp_partition_write(part, sector * SECTOR_SIZE, &hdr, sizeof(hdr)), TAG, "Write failed");
+    cur_sector = sector;
+    cur_seq = hdr.seq;
+    cur_slot = 1;
+    return ESP_OK;
+}
+
+/* Append records, *written counts the ones in flash also when a write fails */
+static esp_err_t log_append(const move_record_t *records, unsigned int n, unsigned int *written)
+{
+    *written = 0;
+    while (*written < n) {
+        if (cur_sector < 0 || cur_slot >= SECTOR_SLOTS) {
+            ESP_RETURN_ON_ERROR(log_open_sector(), TAG, "Sector open failed");
+        }
+        unsigned int chunk = SECTOR_SLOTS - cur_slot;
+        chunk = (n - *written < chunk) ? n - *written : chunk;
+        esp_err_t ret = esp_partition_write(part, cur_sector * SECTOR_SIZE + cur_slot * sizeof(move_record_t),
+                                            records + *written, chunk * sizeof(move_record_t));
+        if (ret != ESP_OK) {
+            cur_slot = SECTOR_SLOTS;    // Slots may be partly programmed, continue in a fresh sector
+            ESP_LOGW(TAG, "Write failed (%s)", esp_err_to_name(ret));
+            return ret;
+        }
+        cur_slot += chunk;
+        *written += chunk;
+    }
+    return ESP_OK;
+}
+
+static void flush_task(void *arg)
+{
+    static move_record_t batch[BATCH_RECORDS];     // Internal RAM, flash writes do not read PSRAM
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&ring_head, memory_order_acquire);
+        while (tail != head) {
+            unsigned int n = 0;
+            while (tail + n != head && n < BATCH_RECORDS) {
+                batch[n] = ring[(tail + n) & RING_MASK];
+                n++;
+            }
+
+            /* The slots are released only once their records are in flash */
+            unsigned int written;
+            xSemaphoreTake(log_lock, portMAX_DELAY);
+            esp_err_t ret = log_append(batch, n, &written);
+            xSemaphoreGive(log_lock);
+            tail += written;
+            flushed += written;
+            atomic_store_explicit(&ring_tail, tail, memory_order_release);
+            if (ret != ESP_OK) {
+                failed++;
+                break;      // Retried with the next flush
+            }
+            head = atomic_load_explicit(&ring_head, memory_order_acquire);
+        }
+    }
+}
+
+esp_err_t gamelog_init(void)
+{
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, GAMELOG_PARTITION_SUBTYPE, GAMELOG_PARTITION_LABEL);
+    ESP_RETURN_ON_FALSE(part != NULL, ESP_ERR_NOT_FOUND, TAG, "Partition '%s' not found", GAMELOG_PARTITION_LABEL);
+    sectors = part->size / SECTOR_SIZE;
+
+    ring = heap_caps_malloc(GAMELOG_RING_SIZE * sizeof(move_record_t), MALLOC_CAP_SPIRAM);
+    if (ring == NULL) {
+        ring = heap_caps_malloc(GAMELOG_RING_SIZE * sizeof(move_record_t), MALLOC_CAP_8BIT);
+    }
+    assert(ring != NULL);
+    log_lock = xSemaphoreCreateMutex();
+    assert(log_lock != NULL);
+
+    log_find_end();
+    if (cur_sector >= 0) {
+        ESP_LOGI(TAG, "Log end: sector %d slot %u, seq %u", cur_sector, cur_slot, (unsigned)cur_seq);
+    }
+    APP_TASK_CREATE(flush_task, "gamelog", 3072, NULL, 2, &flush_handle);
+    return ESP_OK;
+}
+
+void gamelog_record(const move_record_t *record)
+{
+    if (ring == NULL) {
+        return;
+    }
+
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (head - tail >= GAMELOG_RING_SIZE) {
+        dropped++;
+        return;
+    }
+    ring[head & RING_MASK] = *record;
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    recorded++;
+
+    if (head + 1 - tail >= RING_FLUSH_LEVEL) {
+        xTaskNotifyGive(flush_handle);
+    }
+}
+
+void gamelog_flush(void)
+{
+    if (flush_handle != NULL) {
+        xTaskNotifyGive(flush_handle);
+    }
+}
+
+/* Print records of one sector, skipping the first 'skip' of them */
+static uint32_t dump_sector(FILE *out, unsigned int sector, uint32_t *skip, uint16_t *game)
+{
+    move_record_t r[16];
+    uint32_t n = 0;
+
+    for (unsigned int slot = 1; slot < SECTOR_SLOTS; slot += 16) {
+        esp_partition_read(part, sector * SECTOR_SIZE + slot * sizeof(move_record_t), r, sizeof(r));
+        for (unsigned int i = 0; i < 16 && slot + i < SECTOR_SLOTS; i++) {
+            if (slot_erased(&r[i])) {
+                return n;
+            }
+            n++;
+            if (r[i].move == 1) {
+                (*game)++;
+            }
+            if (*skip > 0) {
+                (*skip)--;
+                continue;
+            }
+            if (out != NULL) {
+                fprintf(out, "%u,%u,%u,%u,%u,%u,%u\n", *game, (unsigned)r[i].move, (unsigned)r[i].player + 1,
+                        (unsigned)r[i].time_ms, (unsigned)r[i].used_ms, (unsigned)r[i].remaining_ms,
+                        (unsigned)r[i].increment_ms);
+            }
+        }
+    }
+    return n;
+}
+
+void gamelog_dump_csv(FILE *out, uint32_t max_moves)
+{
+    if (part == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    uint32_t total = 0, skip = 0;
+    uint16_t game = 0;
+    if (cur_sector >= 0) {
+        /* Oldest sector follows the newest one */
+        for (unsigned int i = 1; i <= sectors; i++) {
+            unsigned int s = (cur_sector + i) % sectors;
+            sector_header_t hdr;
+            if (sector_header_read(s, &hdr)) {
+                total += dump_sector(NULL, s, &skip, &game);
+            }
+        }
+    }
+
+    skip = (max_moves && total > max_moves) ? total - max_moves : 0;
+    game = 0;
+    fprintf(out, "game,move,player,time_ms,used_ms,remaining_ms,increment_ms\n");
+    if (cur_sector >= 0) {
+        for (unsigned int i = 1; i <= sectors; i++) {
+            unsigned int s = (cur_sector + i) % sectors;
+            sector_header_t hdr;
+            if (sector_header_read(s, &hdr)) {
+                dump_sector(out, s, &skip, &game);
+            }
+        }
+    }
+    xSemaphoreGive(log_lock);
+}
+
+void gamelog_get_stats(gamelog_stats_t *stats)
+{
+    stats->recorded = recorded;
+    stats->dropped = dropped;
+    stats->pending = atomic_load(&ring_head) - atomic_load(&ring_tail);
+    stats->flushed = flushed;
+    stats->failed = failed;
+}
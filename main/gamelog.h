@@ -0,0 +1,65 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+/**
+ * Move record
+ *
+ * Every move is stored as a 16-byte record in a ring in PSRAM. The clock task is the only
+ * writer and never blocks or touches flash. A low-priority task appends the records in
+ * batches to the 'gamelog' partition, a circular log of sectors with a sequence number
+ * header. Flushing is deferred until no clock is running unless the ring fills up, because
+ * flash writes stall code execution from flash. Records leave the ring only once they are in
+ * flash, a failed write is retried with the next flush.
+ */
+
+#define GAMELOG_PARTITION_LABEL     "gamelog"
+#define GAMELOG_PARTITION_SUBTYPE   (0x41)
+#define GAMELOG_RING_SIZE           (1024)  // Records, power of two
+
+/* Binary record, a new game starts with move 1 */
+typedef struct {
+    uint32_t time_ms;           // Move timestamp since boot
+    uint32_t used_ms;           // Time used for the move
+    uint32_t remaining_ms;      // Remaining time after the move, increment included
+    uint16_t move : 15;         // Move number in the game
+    uint16_t player : 1;        // 0 = player 1
+    uint16_t increment_ms;      // Increment or time given back after the move, saturates
+} move_record_t;
+
+typedef struct {
+    uint32_t recorded;          // Moves recorded since boot
+    uint32_t dropped;           // Moves lost on a full ring
+    uint32_t pending;           // Moves not yet in flash
+    uint32_t flushed;           // Moves written to flash since boot
+    uint32_t failed;            // Flash writes that failed, their moves stay pending
+} gamelog_stats_t;
+
+/**
+ * @brief Allocate the ring, find the end of the log and start the flush task
+ */
+esp_err_t gamelog_init(void);
+
+/**
+ * @brief Record a move, never blocks, call from the clock task only
+ */
+void gamelog_record(const move_record_t *record);
+
+/**
+ * @brief Ask for the pending records to be written now (e.g. the game has stopped)
+ */
+void gamelog_flush(void);
+
+/**
+ * @brief Write the log in flash as CSV, oldest first
+ *
+ * @param max_moves Print at most this many newest moves, 0 for all
+ */
+void gamelog_dump_csv(FILE *out, uint32_t max_moves);
+
+/**
+ * @brief Get record counters
+ */
+void gamelog_get_stats(gamelog_stats_t *stats);
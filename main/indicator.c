@@ -0,0 +1,91 @@
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "bsp/esp-bsp.h"
+#include "led_strip.h"
+#include "alloc.h"
+#include "latency.h"
+#include "indicator.h"
+
+#define LED_BRIGHTNESS  (15)
+
+typedef struct {
+    enum ClockStates state;
+    enum Players active_player;
+    int64_t press_us;
+} indicator_state_t;
+
+static const char *TAG = "indicator";
+static led_strip_handle_t rgb_led = NULL;
+static TaskHandle_t indicator_handle;
+
+/* Latest posted state, the worker picks it up on its next wake-up */
+static indicator_state_t posted;
+static portMUX_TYPE posted_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void indicator_apply(const indicator_state_t *s)
+{
+    if (s->state == Playing) {
+        if (s->active_player == Player1) {
+            led_strip_set_pixel(rgb_led, 0, 0, 0, LED_BRIGHTNESS);
+        }
+        else {
+            led_strip_set_pixel(rgb_led, 0, LED_BRIGHTNESS, 0, 0);
+        }
+    }
+    else {
+        led_strip_set_pixel(rgb_led, 0, 0, 0, 0);
+    }
+    led_strip_refresh(rgb_led);
+}
+
+static void indicator_worker(void *arg)
+{
+    indicator_state_t shown = { .state = Setup, .active_player = Player1, .press_us = 0 };
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        indicator_state_t s;
+        taskENTER_CRITICAL(&posted_lock);
+        s = posted;
+        taskEXIT_CRITICAL(&posted_lock);
+
+        /* LED is dark in every state but Playing, skip transitions it would not show */
+        bool lit = (s.state == Playing);
+        bool was_lit = (shown.state == Playing);
+        if (lit != was_lit || (lit && s.active_player != shown.active_player)) {
+            indicator_apply(&s);
+            latency_record(LatencyLed, s.press_us, esp_timer_get_time());
+        }
+        shown = s;
+    }
+}
+
+esp_err_t indicator_init(void)
+{
+    const led_strip_config_t rgb_config = {
+        .strip_gpio_num = BSP_LEDSTRIP_IO,
+        .max_leds = 1,
+    };
+    const led_strip_rmt_config_t rmt_config = {0};
+    ESP_RETURN_ON_ERROR(led_strip_new_rmt_device(&rgb_config, &rmt_config, &rgb_led), TAG, "LED strip create failed");
+    ESP_RETURN_ON_ERROR(led_strip_clear(rgb_led), TAG, "LED strip clear failed");
+
+    posted.state = Setup;
+    posted.active_player = Player1;
+    APP_TASK_CREATE(indicator_worker, "indicator", 2048, NULL, 4, &indicator_handle);
+    return ESP_OK;
+}
+
+void indicator_post(const clock_view_t *view, int64_t press_us)
+{
+    taskENTER_CRITICAL(&posted_lock);
+    posted.state = view->state;
+    posted.active_player = view->active_player;
+    posted.press_us = press_us;
+    taskEXIT_CRITICAL(&posted_lock);
+    xTaskNotifyGive(indicator_handle);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "esp_err.h"
+#include "clock.h"
+
+/**
+ * Active player indicator
+ *
+ * Drives the RGB LED from a low-priority worker task. Posting a new state never blocks,
+ * states posted faster than the worker applies them are coalesced to the latest one.
+ * The player borders on the display are drawn by disp_update().
+ */
+
+/**
+ * @brief Create RGB LED driver and start the worker task
+ */
+esp_err_t indicator_init(void);
+
+/**
+ * @brief Post clock state to show, never blocks
+ *
+ * @param press_us Press of the move that caused the state, traced as LatencyLed. 0 if none
+ */
+void indicator_post(const clock_view_t *view, int64_t press_us);
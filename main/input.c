@@ -0,0 +1,119 @@
+#include <stdatomic.h>
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#include "bsp/esp-bsp.h"
+#include "debounce.h"
+#include "input.h"
+
+#define INPUT_RING_MASK     (INPUT_RING_SIZE - 1)
+
+static const char *TAG = "input";
+static button_handle_t buttons[BSP_BUTTON_NUM];
+static debounce_t debouncers[BSP_BUTTON_NUM];
+static esp_timer_handle_t sample_timer;
+static TaskHandle_t consumer;
+static volatile uint32_t idle_period_us = INPUT_SAMPLE_PERIOD_US;  // See input_set_sample_period()
+static uint32_t timer_period_us = INPUT_SAMPLE_PERIOD_US;           // Used by the sampler only
+
+/* Single producer (sampler) / single consumer ring, head and tail are free running */
+static input_event_t ring[INPUT_RING_SIZE];
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+static volatile uint32_t presses;
+static volatile uint32_t dropped;
+
+static bool ring_push(uint8_t button, int64_t time_us)
+{
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (head - tail >= INPUT_RING_SIZE) {
+        dropped++;
+        return false;
+    }
+    ring[head & INPUT_RING_MASK] = (input_event_t) {
+        .button = button,
+        .time_us = time_us,
+    };
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    return true;
+}
+
+bool input_read(input_event_t *event)
+{
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *event = ring[tail & INPUT_RING_MASK];
+    atomic_store_explicit(&ring_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/* Runs in the esp_timer task. The button component's own 5 ms scan timer is stopped in
+   input_init(), this sampler is the only reader of the ADC ladder */
+static void input_sample(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    bool pushed = false;
+    bool idle = true;
+
+    for (uint8_t i = 0; i < BSP_BUTTON_NUM; i++) {
+        /* Kaluga buttons are an ADC ladder, level is 1 while the button voltage is in range */
+        bool pressed = iot_button_get_key_level(buttons[i]);
+        int64_t press_us;
+        if (debounce_sample(&debouncers[i], pressed, now, &press_us)) {
+            presses++;
+            pushed |= ring_push(i, press_us);
+        }
+        idle &= (debouncers[i].state == DebounceReleased);
+    }
+    if (pushed) {
+        xTaskNotifyGive(consumer);
+    }
+
+    /* A button in motion is followed at full rate until it is released again */
+    uint32_t period = idle ? idle_period_us : INPUT_SAMPLE_PERIOD_US;
+    if (period != timer_period_us) {
+        timer_period_us = period;
+        esp_timer_restart(sample_timer, period);
+    }
+}
+
+esp_err_t input_init(TaskHandle_t notify_task)
+{
+    consumer = notify_task;
+    for (int i = 0; i < BSP_BUTTON_NUM; i++) {
+        buttons[i] = iot_button_create(&bsp_button_config[i]);
+        assert(buttons[i] != NULL);
+        debounce_init(&debouncers[i]);
+    }
+    /* Creating a button starts the component's scan timer, its callbacks are not used and the
+       timer would wake the chip every 5 ms */
+    ESP_RETURN_ON_ERROR(iot_button_stop(), TAG, "Button timer stop failed");
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = input_sample,
+        .name = "input",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &sample_timer), TAG, "Timer create failed");
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(sample_timer, INPUT_SAMPLE_PERIOD_US), TAG, "Timer start failed");
+    return ESP_OK;
+}
+
+void input_set_sample_period(uint32_t period_us)
+{
+    idle_period_us = period_us;
+}
+
+void input_get_stats(input_stats_t *stats)
+{
+    stats->pending = atomic_load(&ring_head) - atomic_load(&ring_tail);
+    stats->presses = presses;
+    stats->dropped = dropped;
+    stats->glitches = 0;
+    for (int i = 0; i < BSP_BUTTON_NUM; i++) {
+        stats->glitches += debouncers[i].glitches;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * Button input
+ *
+ * Board buttons are sampled every INPUT_SAMPLE_PERIOD_US and debounced per button. While no
+ * button is pressed the period can be made longer with input_set_sample_period(), the first
+ * sampled edge switches back to INPUT_SAMPLE_PERIOD_US until all buttons are released. Every
+ * confirmed press is stored with the timestamp of its first edge in a lock-free ring and the
+ * consumer task is notified. A full ring drops the press and counts it.
+ */
+
+#define INPUT_SAMPLE_PERIOD_US  (1000)
+#define INPUT_RING_SIZE         (32)    // Power of two
+
+typedef struct {
+    uint8_t button;         // BSP button index
+    int64_t time_us;        // First edge of the press
+} input_event_t;
+
+typedef struct {
+    uint32_t pending;       // Presses in the ring
+    uint32_t presses;       // Confirmed presses
+    uint32_t dropped;       // Presses lost on a full ring
+    uint32_t glitches;      // Level changes rejected as bounces
+} input_stats_t;
+
+/**
+ * @brief Create board buttons and start sampling
+ *
+ * @param notify_task Task notified (xTaskNotifyGive) when new events are available
+ */
+esp_err_t input_init(TaskHandle_t notify_task);
+
+/**
+ * @brief Take the oldest press, call from the notified task only
+ *
+ * @return false when the ring is empty
+ */
+bool input_read(input_event_t *event);
+
+/**
+ * @brief Set the sampling period while no button is pressed, applied with the next sample
+ *
+ * A longer period delays the first edge of a press by up to one period and misses presses
+ * shorter than it.
+ */
+void input_set_sample_period(uint32_t period_us);
+
+/**
+ * @brief Get input counters
+ */
+void input_get_stats(input_stats_t *stats);
@@ -0,0 +1,200 @@
+#include <string.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "alloc.h"
+#include "journal.h"
+
+#define JOURNAL_NAMESPACE   "clock"
+#define JOURNAL_KEY_RECORD  "ckpt"      // journal_record_t blob
+#define RECORD_VERSION      (5)
+
+/* u64 records of version 4 and older, erased on init and not restored */
+static const char *const legacy_keys[] = { "game", "time", "setup", "set" };
+
+/* One blob, NVS replaces it as a whole: a reset restores either the previous or the new checkpoint */
+typedef struct {
+    uint8_t version;
+    uint8_t state;
+    uint8_t active_player;
+    uint8_t control;
+    uint32_t set_time_ms;
+    uint32_t remaining_ms[2];
+    uint16_t player_moves[2];
+} journal_record_t;
+
+_Static_assert(sizeof(journal_record_t) == 20, "Journal record must have no padding, it is compared with memcmp");
+
+static const char *TAG = "journal";
+static nvs_handle_t nvs;
+static TaskHandle_t journal_handle;
+
+/* Latest posted state, picked up by the journal task */
+static clock_view_t posted;
+static portMUX_TYPE posted_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile uint32_t writes;
+static volatile uint32_t failed;
+static volatile uint32_t coalesced;
+
+static void record_pack(const clock_view_t *view, journal_record_t *record)
+{
+    *record = (journal_record_t) {
+        .version = RECORD_VERSION,
+        .state = view->state,
+        .active_player = view->active_player,
+        .control = view->control,
+        .set_time_ms = view->set_time_ms,
+    };
+    for (int p = Player1; p <= Player2; p++) {
+        record->remaining_ms[p] = view->remaining_ms[p];
+        record->player_moves[p] = view->player_moves[p];
+    }
+}
+
+static bool record_unpack(const journal_record_t *record, clock_view_t *view)
+{
+    if (record->version != RECORD_VERSION) {
+        return false;
+    }
+    view->state = record->state;
+    view->active_player = record->active_player;
+    view->control = record->control;
+    view->set_time_ms = record->set_time_ms;
+    for (int p = Player1; p <= Player2; p++) {
+        view->remaining_ms[p] = record->remaining_ms[p];
+        view->player_moves[p] = record->player_moves[p];
+    }
+    return true;
+}
+
+/* Everything but the remaining times, i.e. a move, a state change or a new setup */
+static bool record_changed(const journal_record_t *a, const journal_record_t *b)
+{
+    return a->state != b->state || a->active_player != b->active_player || a->control != b->control ||
+           a->set_time_ms != b->set_time_ms || memcmp(a->player_moves, b->player_moves, sizeof(a->player_moves));
+}
+
+static bool record_read(journal_record_t *record)
+{
+    size_t size = sizeof(*record);
+    return nvs_get_blob(nvs, JOURNAL_KEY_RECORD, record, &size) == ESP_OK && size == sizeof(*record);
+}
+
+bool journal_init(clock_view_t *saved)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS erased (%s)", esp_err_to_name(ret));
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    ESP_ERROR_CHECK(nvs_open(JOURNAL_NAMESPACE, NVS_READWRITE, &nvs));
+    bool erased = false;
+    for (size_t i = 0; i < sizeof(legacy_keys) / sizeof(legacy_keys[0]); i++) {
+        erased |= (nvs_erase_key(nvs, legacy_keys[i]) == ESP_OK);
+    }
+    if (erased) {
+        nvs_commit(nvs);
+    }
+
+    journal_record_t record;
+    if (!record_read(&record) || !record_unpack(&record, saved)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Restored game: state %d, player %d, %u / %u ms", saved->state, saved->active_player + 1,
+             (unsigned)saved->remaining_ms[Player1], (unsigned)saved->remaining_ms[Player2]);
+    return true;
+}
+
+static void journal_task(void *arg)
+{
+    journal_record_t written = { 0 };
+    int64_t last_write = -JOURNAL_PERIOD_US;
+    bool pending = false;
+    TickType_t wait = portMAX_DELAY;
+
+    record_read(&written);
+
+    while (1) {
+        if (ulTaskNotifyTake(pdTRUE, wait) && pending) {
+            coalesced++;
+        }
+
+        clock_view_t view;
+        taskENTER_CRITICAL(&posted_lock);
+        view = posted;
+        taskEXIT_CRITICAL(&posted_lock);
+
+        journal_record_t record;
+        record_pack(&view, &record);
+        pending = (memcmp(&record, &written, sizeof(record)) != 0);
+        wait = portMAX_DELAY;
+        if (!pending) {
+            continue;
+        }
+
+        /* Moves and state changes are written soon, a running clock only periodically */
+        bool changed = record_changed(&record, &written);
+        int64_t due = last_write + (changed ? JOURNAL_MIN_INTERVAL_US : JOURNAL_PERIOD_US);
+        int64_t now = esp_timer_get_time();
+        if (now < due) {
+            wait = pdMS_TO_TICKS((due - now + 999) / 1000) + 1;
+            continue;
+        }
+
+        last_write = now;
+        esp_err_t ret = nvs_set_blob(nvs, JOURNAL_KEY_RECORD, &record, sizeof(record));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        if (ret != ESP_OK) {
+            /* written is kept, the checkpoint is retried after the minimum interval */
+            ESP_LOGW(TAG, "Checkpoint failed (%s)", esp_err_to_name(ret));
+            failed++;
+            wait = pdMS_TO_TICKS(JOURNAL_MIN_INTERVAL_US / 1000) + 1;
+            continue;
+        }
+        written = record;
+        pending = false;
+        writes++;
+    }
+}
+
+esp_err_t journal_start(void)
+{
+    APP_TASK_CREATE(journal_task, "journal", 3072, NULL, 3, &journal_handle);
+    return ESP_OK;
+}
+
+void journal_post(const clock_view_t *view)
+{
+    taskENTER_CRITICAL(&posted_lock);
+    posted = *view;
+    taskEXIT_CRITICAL(&posted_lock);
+    xTaskNotifyGive(journal_handle);
+}
+
+void journal_get_stats(journal_stats_t *stats)
+{
+    stats->writes = writes;
+    stats->entries = writes * JOURNAL_ENTRIES_PER_WRITE;
+    stats->failed = failed;
+    stats->coalesced = coalesced;
+
+    nvs_stats_t nvs_stats;
+    if (nvs_get_stats(NULL, &nvs_stats) == ESP_OK) {
+        stats->used_entries = nvs_stats.used_entries;
+        stats->total_entries = nvs_stats.total_entries;
+    }
+    else {
+        stats->used_entries = 0;
+        stats->total_entries = 0;
+    }
+}
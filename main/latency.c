@@ -0,0 +1,93 @@
+#include <string.h>
+#include "latency.h"
+
+typedef struct {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+} latency_hist_t;
+
+static latency_hist_t hists[LATENCY_STAGE_NUM];
+
+static const char *const stage_names[LATENCY_STAGE_NUM] = {
+    [LatencyDequeue] = "dequeue",
+    [LatencyClock] = "clock",
+    [LatencyLed] = "led",
+    [LatencyDisplay] = "display",
+};
+
+/* Values below 32 have own buckets, above that 16 buckets per power of two */
+static unsigned int bucket_index(uint32_t us)
+{
+    if (us < 32) {
+        return us;
+    }
+    unsigned int shift = 31 - __builtin_clz(us) - 4;
+    return 16 * shift + (us >> shift);
+}
+
+static uint32_t bucket_value(unsigned int index)
+{
+    if (index < 32) {
+        return index;
+    }
+    unsigned int shift = index / 16 - 1;
+    return (index % 16 + 16) << shift;
+}
+
+void latency_record(latency_stage_t stage, int64_t press_us, int64_t now_us)
+{
+    if (press_us == 0 || stage >= LATENCY_STAGE_NUM) {
+        return;
+    }
+    int64_t delay = now_us - press_us;
+    uint32_t us = (delay < 0) ? 0 : (delay > LATENCY_MAX_US) ? LATENCY_MAX_US : (uint32_t)delay;
+
+    latency_hist_t *h = &hists[stage];
+    h->buckets[bucket_index(us)]++;
+    if (h->count == 0 || us < h->min_us) {
+        h->min_us = us;
+    }
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+    h->count++;
+}
+
+static uint32_t percentile(const latency_hist_t *h, uint32_t count, unsigned int pct)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            return bucket_value(i);
+        }
+    }
+    return h->max_us;
+}
+
+void latency_get(latency_stage_t stage, latency_summary_t *summary)
+{
+    const latency_hist_t *h = &hists[stage];
+    memset(summary, 0, sizeof(*summary));
+    summary->count = h->count;
+    if (summary->count == 0) {
+        return;
+    }
+    summary->min_us = h->min_us;
+    summary->max_us = h->max_us;
+    summary->p50_us = percentile(h, summary->count, 50);
+    summary->p99_us = percentile(h, summary->count, 99);
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    return (stage < LATENCY_STAGE_NUM) ? stage_names[stage] : "?";
+}
+
+void latency_reset(void)
+{
+    memset(hists, 0, sizeof(hists));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+/**
+ * Press-to-photon latency histograms
+ *
+ * Every stage of a move is traced against the first edge of the button press that caused it
+ * and the delay is added to the stage histogram. Buckets are log-linear, 16 per power of two
+ * (< 7 % error) up to LATENCY_MAX_US.
+ *
+ * Each stage must be recorded from a single task. The module has no dependency on FreeRTOS.
+ */
+
+#define LATENCY_MAX_US      ((1 << 21) - 1)     // Larger delays are clamped, ~2.1 s
+#define LATENCY_BUCKETS     (288)
+
+typedef enum {
+    LatencyDequeue,     // Press taken from the input ring by the clock loop
+    LatencyClock,       // Clock state changed
+    LatencyLed,         // RGB LED refreshed
+    LatencyDisplay,     // LVGL rendered and flushed the change
+    LATENCY_STAGE_NUM
+} latency_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} latency_summary_t;
+
+/**
+ * @brief Add one delay to a stage histogram
+ *
+ * @param press_us Timestamp of the press, nothing is recorded for 0
+ * @param now_us Timestamp of the stage
+ */
+void latency_record(latency_stage_t stage, int64_t press_us, int64_t now_us);
+
+/**
+ * @brief Get stage statistics, percentiles are bucket lower bounds
+ */
+void latency_get(latency_stage_t stage, latency_summary_t *summary);
+
+/**
+ * @brief Stage name for reports
+ */
+const char *latency_stage_name(latency_stage_t stage);
+
+/**
+ * @brief Clear all histograms
+ */
+void latency_reset(void);
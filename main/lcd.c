@@ -0,0 +1,134 @@
+#include <string.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_lcd_panel_ops.h"
+#include "esp_lvgl_port.h"
+
+#include "bsp/esp-bsp.h"
+#include "bsp/display.h"
+#include "lcd.h"
+
+#define LCD_BUF_PX      (BSP_LCD_H_RES * CONFIG_CHESS_LCD_BUF_LINES)
+
+#if CONFIG_CHESS_LCD_DOUBLE_BUF
+#define LCD_BUF_NUM     (2)
+#else
+#define LCD_BUF_NUM     (1)
+#endif
+
+#if CONFIG_CHESS_LCD_BUF_SPIRAM
+#define LCD_BUF_SPIRAM  (1)
+#else
+#define LCD_BUF_SPIRAM  (0)
+#endif
+
+static const char *TAG = "lcd";
+
+/* Updated from the LVGL task with the display lock held */
+static void (*port_flush_cb)(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
+static bool waiting;
+static int64_t wait_start;
+static int64_t wait_last;
+static lcd_stats_t stats;
+static int64_t stats_since;
+
+/* LVGL calls this in a loop while a buffer it needs is still being transferred */
+static void lcd_wait(lv_disp_drv_t *drv)
+{
+    int64_t now = esp_timer_get_time();
+    if (!waiting) {
+        wait_start = now;
+        waiting = true;
+    }
+    wait_last = now;
+}
+
+static void lcd_wait_done(void)
+{
+    if (waiting) {
+        stats.wait_us += wait_last - wait_start;
+        waiting = false;
+    }
+}
+
+static void lcd_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    lcd_wait_done();
+    stats.flushes++;
+    port_flush_cb(drv, area, color_map);
+}
+
+lv_disp_t *lcd_start(void)
+{
+    const bsp_display_config_t bsp_cfg = {
+        .max_transfer_sz = LCD_BUF_PX * sizeof(uint16_t),
+    };
+    esp_lcd_panel_handle_t panel;
+    esp_lcd_panel_io_handle_t io;
+    ESP_ERROR_CHECK(bsp_display_new(&bsp_cfg, &panel, &io));
+    esp_lcd_panel_disp_on_off(panel, true);
+
+    const lvgl_port_cfg_t port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+    ESP_ERROR_CHECK(lvgl_port_init(&port_cfg));
+
+    /* In DMA capable internal RAM the SPI master sends the buffers without a copy. From PSRAM
+       the driver goes through a bounce buffer and the CPU copies every area. */
+    const lvgl_port_display_cfg_t disp_cfg = {
+        .io_handle = io,
+        .panel_handle = panel,
+        .buffer_size = LCD_BUF_PX,
+        .double_buffer = (LCD_BUF_NUM == 2),
+        .hres = BSP_LCD_H_RES,
+        .vres = BSP_LCD_V_RES,
+        .monochrome = false,
+        .rotation = {
+            .swap_xy = false,
+            .mirror_x = true,
+            .mirror_y = true,
+        },
+        .flags = {
+            .buff_dma = !LCD_BUF_SPIRAM,
+            .buff_spiram = LCD_BUF_SPIRAM,
+            .sw_rotate = false,
+        },
+    };
+    lv_disp_t *disp = lvgl_port_add_disp(&disp_cfg);
+    assert(disp != NULL);
+
+    lvgl_port_lock(0);
+    port_flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = lcd_flush;
+    disp->driver->wait_cb = lcd_wait;
+    /* The port's driver update callback programs the panel swap/mirror bits for the new
+       orientation, LVGL renders straight into landscape coordinates */
+    lv_disp_set_rotation(disp, LV_DISP_ROT_90);
+    stats_since = esp_timer_get_time();
+    lvgl_port_unlock();
+
+    ESP_LOGI(TAG, "%d draw buffer(s) of %d lines in %s", LCD_BUF_NUM, CONFIG_CHESS_LCD_BUF_LINES,
+             LCD_BUF_SPIRAM ? "PSRAM" : "DMA RAM");
+    return disp;
+}
+
+void lcd_refreshed(uint32_t time_ms, uint32_t px)
+{
+    lcd_wait_done();
+    stats.frames++;
+    stats.pixels += px;
+    stats.refresh_us += (uint64_t)time_ms * 1000;
+    if (time_ms > stats.refresh_max_ms) {
+        stats.refresh_max_ms = time_ms;
+    }
+}
+
+void lcd_get_stats(lcd_stats_t *out)
+{
+    lvgl_port_lock(0);
+    int64_t now = esp_timer_get_time();
+    *out = stats;
+    out->interval_us = now - stats_since;
+    memset(&stats, 0, sizeof(stats));
+    stats_since = now;
+    lvgl_port_unlock();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include "lvgl.h"
+
+/**
+ * LCD backend
+ *
+ * Starts LVGL on the Kaluga LCD with two draw buffers (CONFIG_CHESS_LCD_*), so LVGL renders
+ * the next area while the previous one is transferred by SPI DMA. The 90 degree rotation is
+ * done by the panel (MADCTL row/column exchange), not by LVGL in software.
+ *
+ * Refreshes are timed: total render + flush time from the LVGL monitor callback, and the time
+ * LVGL spent blocked waiting for a transfer to finish.
+ */
+
+typedef struct {
+    int64_t interval_us;        // Time covered by the stats
+    uint32_t frames;            // LVGL refreshes
+    uint32_t flushes;           // Areas sent to the panel
+    uint64_t pixels;            // Pixels rendered and sent
+    uint64_t refresh_us;        // Sum of refresh times
+    uint32_t refresh_max_ms;
+    uint64_t wait_us;           // Time blocked on a transfer
+} lcd_stats_t;
+
+/**
+ * @brief Create panel and LVGL display, rotated for landscape
+ *
+ * Replaces bsp_display_start() and bsp_display_rotate(), the BSP display lock still applies.
+ */
+lv_disp_t *lcd_start(void);
+
+/**
+ * @brief LVGL finished a refresh, call from the LVGL monitor callback
+ */
+void lcd_refreshed(uint32_t time_ms, uint32_t px);
+
+/**
+ * @brief Get stats since the previous call
+ */
+void lcd_get_stats(lcd_stats_t *stats);
@@ -10,388 +10,282 @@
 #include <unistd.h>
 #include <string.h>
 #include "esp_log.h"
-#include "esp_spiffs.h"
+#include "esp_timer.h"
 
 #include "bsp/esp-bsp.h"
-#include "es8311.h"
-#include "led_strip.h"
 #include "lvgl.h"
 #include "disp.h"
-
-/* Buffer for reading/writing to I2S driver. Same length as SPIFFS buffer and I2S buffer, for optimal read/write performance.
-   Recording audio data path:
-   I2S peripheral -> I2S buffer (DMA) -> App buffer (RAM) -> SPIFFS buffer -> External SPI Flash.
-   Vice versa for playback. */
-#define BUFFER_SIZE     (1024)
-#define SAMPLE_RATE     (22050)
-#define DEFAULT_VOLUME  (60)
-/* The recording will be RECORDING_LENGTH * BUFFER_SIZE long (in bytes)
-   With sampling frequency 22050 Hz and 16bit mono resolution it equals to ~3.715 seconds */
-// #define RECORDING_LENGTH (160)
+#include "assets.h"
+#include "audio.h"
+#include "clock.h"
+#include "input.h"
+#include "indicator.h"
+#include "latency.h"
+#include "console.h"
+#include "alloc.h"
+#include "power.h"
+#include "boot.h"
+#include "journal.h"
+#include "gamelog.h"
+#include "lcd.h"
+#include "calib.h"
+
+#define LOW_TIME_WARNING_SEC    (10)    // Beep when the active clock reaches this, and every second below 5 s
 
 /* Globals */
 static const char *TAG = "example";
-static button_handle_t audio_button[BSP_BUTTON_NUM] = {};
-static QueueHandle_t audio_button_q = NULL;
-static led_strip_handle_t rgb_led = NULL;
-static i2s_chan_handle_t i2s_tx_chan;
-static i2s_chan_handle_t i2s_rx_chan;
-
-
-enum ClockStates {
-    Setup,
-    Pause,
-    Playing,
-    Timeout
-};
-enum Players { Player1, Player2 };
 
-enum ClockStates clock_state = Setup;
-enum Players active_player = Player1;
+/* Clock state is owned by clock_loop(), other tasks only see published snapshots */
+static chess_clock_t chess_clock;
+static clock_view_t clock_view;
+static int64_t clock_view_press_us;     // Press of the last move in the snapshot, for latency tracing
+static portMUX_TYPE clock_view_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Move waiting for the LVGL refresh, guarded by the display lock */
+static int64_t flush_press_us;
+
 TaskHandle_t refresh_diaplay_handle;
-TaskHandle_t play_audio_handle;
-unsigned int set_time = 60;         // Starting time [s]
-unsigned int time_step = 10;        // Time to add or subtract with +/- button press [s]
-unsigned int player1_time = 60;      // Remaining time of player1 [s]
-unsigned int player2_time = 60;      // Remaining time of player2 [s]
+TaskHandle_t clock_loop_handle;
+
+/* Board button to clock input mapping */
+static const enum ClockInputs btn_inputs[BSP_BUTTON_NUM] = {
+    [BSP_BUTTON_REC] = InputP2Done,         // Player 2 finish turn
+    [BSP_BUTTON_MODE] = InputTimeUp,        // Increase starting time
+    [BSP_BUTTON_PLAY] = InputPause,         // Play / pause
+    [BSP_BUTTON_SET] = InputReset,          // Reset to starting time, in Setup next time control
+    [BSP_BUTTON_VOLDOWN] = InputTimeDown,   // Decrease starting time
+    [BSP_BUTTON_VOLUP] = InputP1Done,       // Player 1 finish turn
+};
 
 
-static void btn_handler(void *arg, void *arg2)
+/* Copy of the last published clock snapshot */
+static void get_clock_view(clock_view_t *view, int64_t *press_us)
 {
-    for (uint8_t i = 0; i < BSP_BUTTON_NUM; i++) {
-        if ((button_handle_t)arg == audio_button[i]) {
-            xQueueSend(audio_button_q, &i, 0);
-            break;
-        }
-    }
+    taskENTER_CRITICAL(&clock_view_lock);
+    *view = clock_view;
+    *press_us = clock_view_press_us;
+    taskEXIT_CRITICAL(&clock_view_lock);
 }
 
-// Very simple WAV header, ignores most fields
-typedef struct __attribute__((packed))
-{
-    uint8_t ignore_0[22];
-    uint16_t num_channels;
-    uint32_t sample_rate;
-    uint8_t ignore_1[6];
-    uint16_t bits_per_sample;
-    uint8_t ignore_2[4];
-    uint32_t data_size;
-    uint8_t data[];
-} dumb_wav_header_t;
-
-static esp_err_t spiffs_init(void)
+/* Publish clock snapshot and wake up the tasks interested in the changes.
+   press_us is the press of a move among the changes, 0 if there is none */
+static void handle_clock_changes(uint32_t changes, int64_t now, int64_t press_us)
 {
-    esp_err_t ret = ESP_OK;
-    ESP_LOGI(TAG, "Initializing SPIFFS");
-
-    const esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = NULL,
-        .max_files = 5,
-        .format_if_mount_failed = false
-    };
-
-    /*!< Use settings defined above to initialize and mount SPIFFS filesystem. */
-    /*!< Note: esp_vfs_spiffs_register is an all-in-one convenience function. */
-    ret = esp_vfs_spiffs_register(&conf);
-
-    if (ret != ESP_OK) {
-        if (ret == ESP_FAIL) {
-            ESP_LOGE(TAG, "Failed to mount or format filesystem");
-        } else if (ret == ESP_ERR_NOT_FOUND) {
-            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
-        } else {
-            ESP_LOGE(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
-        }
-
-        return ret;
-    }
-
-    size_t total = 0, used = 0;
-    ret = esp_spiffs_info(NULL, &total, &used);
+    clock_view_t view;
+    clock_get_view(&chess_clock, now, &view);
 
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
-    } else {
-        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    taskENTER_CRITICAL(&clock_view_lock);
+    clock_view = view;
+    if (press_us != 0) {
+        clock_view_press_us = press_us;
     }
+    taskEXIT_CRITICAL(&clock_view_lock);
 
-    return ret;
-}
-
-void play_audio() {
-    /* Create and configure ES8311 I2C driver */
-    es8311_handle_t es8311_dev = es8311_create(BSP_I2C_NUM, ES8311_ADDRRES_0);
-    const es8311_clock_config_t clk_cfg = BSP_ES8311_SCLK_CONFIG(SAMPLE_RATE);
-    es8311_init(es8311_dev, &clk_cfg, ES8311_RESOLUTION_16, ES8311_RESOLUTION_16);
-    es8311_voice_volume_set(es8311_dev, DEFAULT_VOLUME, NULL);
-
-    /* Configure I2S peripheral and Power Amplifier */
-    bsp_audio_init(NULL, &i2s_tx_chan, &i2s_rx_chan);
-    bsp_audio_poweramp_enable(true);
-
-    /* Pointer to a file that is going to be played */
-    const char music_filename[] = "/spiffs/16bit_mono_22_05khz.wav";
-    const char *play_filename = music_filename;
-
-    while (1) {
-        vTaskSuspend( NULL );   // Task suspends itself, Waits until resuming
-        
-        int16_t *wav_bytes = malloc(BUFFER_SIZE);
-        assert(wav_bytes != NULL);
-
-        /* Open WAV file */
-        ESP_LOGI(TAG, "Playing file %s", play_filename);
-        FILE *play_file = fopen(play_filename, "rb");
-        if (play_file == NULL) {
-            ESP_LOGW(TAG, "%s file does not exist!", play_filename);
-            return;
-        }
-
-        /* Read WAV header file */
-        dumb_wav_header_t wav_header;
-        if (fread((void *)&wav_header, 1, sizeof(wav_header), play_file) != sizeof(wav_header)) {
-            ESP_LOGW(TAG, "Error in reading file");
-            return;
+    if (changes & CLOCK_CHANGED_PLAYER) {
+        indicator_post(&view, press_us);            // RGB LED
+        power_clock_running(view.state == Playing);
+        if (view.state != Playing) {
+            gamelog_flush();                        // Write moves while no clock is running
         }
-        ESP_LOGI(TAG, "Number of channels: %d", wav_header.num_channels);
-        ESP_LOGI(TAG, "Bits per sample: %d", wav_header.bits_per_sample);
-        ESP_LOGI(TAG, "Sample rate: %d", wav_header.sample_rate);
-        ESP_LOGI(TAG, "Data size: %d", wav_header.data_size);
-
-        uint32_t bytes_send_to_i2s = 0;
-        while (bytes_send_to_i2s < wav_header.data_size) {
-            /* Get data from SPIFFS */
-            size_t bytes_read_from_spiffs = fread(wav_bytes, 1, BUFFER_SIZE, play_file);
-
-            /* Send it to I2S */
-            size_t i2s_bytes_written;
-            ESP_ERROR_CHECK(i2s_channel_write(i2s_tx_chan, wav_bytes, bytes_read_from_spiffs, &i2s_bytes_written, pdMS_TO_TICKS(500)));
-            bytes_send_to_i2s += i2s_bytes_written;
-        }
-
-        fclose(play_file);
-        free(wav_bytes);
     }
-}
+    xTaskNotifyGive(refresh_diaplay_handle);        // Refresh display
+    journal_post(&view);                            // Checkpoint
 
-void update_cb_led() {
-    if (clock_state == Playing) {
-        if (active_player == Player1) {
-            led_strip_set_pixel(rgb_led, 0, 0, 0, 15);
-            disp_set_P1_cb(true);
-            disp_set_P2_cb(false);
-        }
-        else {
-            led_strip_set_pixel(rgb_led, 0, 15, 0, 0);
-            disp_set_P1_cb(false);
-            disp_set_P2_cb(true);
-        }
+    /* Sounds */
+    unsigned int active_sec = clock_display_sec(view.remaining_ms[view.active_player]);
+    if (changes & CLOCK_TIMEOUT) {
+        audio_play(SoundFlagFall);
+    }
+    else if (view.state == Playing && (changes & CLOCK_CHANGED_PLAYER)) {
+        audio_play(SoundClick);
     }
-    else {
-        led_strip_set_pixel(rgb_led, 0, 0, 0, 0);
-        disp_set_P1_cb(false);
-        disp_set_P2_cb(false);
+    else if (view.state == Playing && (changes & CLOCK_CHANGED_TIME) &&
+             (active_sec == LOW_TIME_WARNING_SEC || (active_sec > 0 && active_sec <= 5))) {
+        audio_play(SoundLowTime);
     }
-    led_strip_refresh(rgb_led);
 }
 
-void btn_actions() 
-{   
+/* Event loop owning the clock state.
+   Waits for the input notification, its timeout is the clock tick: it expires when the displayed
+   time changes or the flag falls. All queued presses are applied at their own timestamps.
+   The clock runs on calibrated time, latency is traced on raw esp_timer timestamps. */
+void clock_loop()
+{
     while (1) {
-
-    uint8_t btn_index = 0;
-    if (xQueueReceive(audio_button_q, &btn_index, portMAX_DELAY) != pdTRUE) {
-        continue;
-    }
-            
-    switch (btn_index) {
-        case BSP_BUTTON_REC: {      // Player 2 finish turn
-            if (clock_state == Timeout) {
-                clock_state = Setup;
-                player1_time = set_time;
-                player2_time = set_time;
-                update_cb_led();
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
-            }
-            else if (clock_state == Playing) {
-                active_player = Player1;
-                update_cb_led();
-            }
-            else if (clock_state == Setup || clock_state == Pause) {
-                active_player = Player1;
-                clock_state = Playing;
-                update_cb_led();
-            }
-            break;
+        TickType_t wait = portMAX_DELAY;
+        int64_t now = calib_now_us();
+        int64_t deadline = clock_next_deadline_us(&chess_clock, now);
+        if (deadline != CLOCK_NO_DEADLINE) {
+            wait = pdMS_TO_TICKS((deadline - now + 999) / 1000) + 1;
         }
-        case BSP_BUTTON_MODE: {     // Increase starting time
-            if (clock_state == Setup) {
-                set_time += time_step;
-                player1_time = set_time;
-                player2_time = set_time;
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
-            }
-            else if (clock_state == Timeout) {
-                clock_state = Setup;
-                player1_time = set_time;
-                player2_time = set_time;
-                update_cb_led();
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
-            }
-            break;
-        }
-        case BSP_BUTTON_PLAY: {     // Play / pause
-            if (clock_state == Setup || clock_state == Pause) {
-                clock_state = Playing;
-                if (active_player == Player1) {
-                    update_cb_led();
-                }
-                else {
-                    update_cb_led();
-                }
-            } 
-            else if (clock_state == Playing) {
-                clock_state = Pause;
-                update_cb_led();
-            }
-            else if (clock_state == Timeout) {
-                clock_state = Setup;
-                player1_time = set_time;
-                player2_time = set_time;
-                update_cb_led();
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
+
+        uint32_t changes = 0;
+        int64_t move_press_us = 0;
+        input_event_t event;
+        ulTaskNotifyTake(pdTRUE, wait);
+        while (input_read(&event)) {
+            latency_record(LatencyDequeue, event.time_us, esp_timer_get_time());
+            if (event.button >= BSP_BUTTON_NUM) {
+                ESP_LOGW(TAG, "Button index out of range");
+                continue;
             }
-            break;
-        }
-        case BSP_BUTTON_SET: {      // Reset to starting time
-            clock_state = Setup;
-            player1_time = set_time;
-            player2_time = set_time;
-            update_cb_led();
-            vTaskResume(refresh_diaplay_handle);    // Refresh display
-            break;
-        }
-        case BSP_BUTTON_VOLDOWN: {  // Decrease starting time
-            if (clock_state == Setup) {
-                if (set_time - time_step != 0) {
-                    set_time -= time_step;
-                }
-                player1_time = set_time;
-                player2_time = set_time;
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
+
+            enum ClockInputs input = btn_inputs[event.button];
+            uint32_t c = clock_input(&chess_clock, input, calib_correct_us(event.time_us));
+            if ((input == InputP1Done || input == InputP2Done) && (c & CLOCK_CHANGED_PLAYER)) {
+                /* Moves are traced until the LED and the display show them */
+                move_press_us = event.time_us;
+                latency_record(LatencyClock, event.time_us, esp_timer_get_time());
             }
-            else if (clock_state == Timeout) {
-                clock_state = Setup;
-                player1_time = set_time;
-                player2_time = set_time;
-                update_cb_led();
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
+            if (c & CLOCK_MOVE) {
+                enum Players mover = !chess_clock.active_player;
+                const move_record_t record = {
+                    .time_ms = (uint32_t)(event.time_us / 1000),
+                    .used_ms = chess_clock.last_move_ms,
+                    .remaining_ms = chess_clock.remaining_ms[mover],
+                    .move = chess_clock.moves,
+                    .player = mover,
+                    .increment_ms = (chess_clock.last_bonus_ms > UINT16_MAX) ? UINT16_MAX : chess_clock.last_bonus_ms,
+                };
+                gamelog_record(&record);
             }
-            break;
+            changes |= c;
         }
-        case BSP_BUTTON_VOLUP: {    // Player 1 finish turn
-            if (clock_state == Timeout) {
-                clock_state = Setup;
-                player1_time = set_time;
-                player2_time = set_time;
-                update_cb_led();
-                vTaskResume(refresh_diaplay_handle);    // Refresh display
-            }
-            else if (clock_state == Playing) {
-                active_player = Player2;
-                update_cb_led();
-            }
-            else if (clock_state == Setup || clock_state == Pause) {
-                active_player = Player2;
-                clock_state = Playing;
-                update_cb_led();
-            }
-            break;
+
+        now = calib_now_us();
+        changes |= clock_update(&chess_clock, now);
+        if (changes) {
+            handle_clock_changes(changes, now, move_press_us);
         }
-        default:
-            ESP_LOGW(TAG, "Button index out of range");
     }
 }
-}
 
-// clock tick executed every second
-void clock_tick()
+/* Renderer. Redraws on every published change (1 Hz while a clock runs); below
+   CLOCK_TENTHS_BELOW_MS it also wakes up on its own at each tenth of a second and extrapolates the
+   active clock from the last snapshot, so clock_loop keeps its 1 Hz tick. */
+void refresh_display()
 {
-    TickType_t xLastWakeTime = xTaskGetTickCount();;
-    const TickType_t xPeriod = pdMS_TO_TICKS(1000);    // clock period in ms
+    clock_view_t view;
+    int64_t press_us;
+    int64_t traced_press_us = 0;
+    TickType_t wait = portMAX_DELAY;
 
     while(1) {
-        vTaskDelayUntil( &xLastWakeTime, xPeriod );
-
-        if (clock_state == Playing) {
-            if (active_player == Player1) {
-                player1_time--;
-                if (player1_time == 0) {
-                    clock_state = Timeout;
-                    vTaskResume(play_audio_handle);     // Play audio
-                }
-            }
-            else if (active_player == Player2) {
-                player2_time--;
-                if (player2_time == 0) {
-                    clock_state = Timeout;
-                    vTaskResume(play_audio_handle);     // Play audio
-                }
-            }
-            vTaskResume(refresh_diaplay_handle);        // Refresh display
+        ulTaskNotifyTake(pdTRUE, wait);             // Wait for clock change or the next tenth
+        get_clock_view(&view, &press_us);
+
+        int64_t now = calib_now_us();
+        int64_t next = clock_view_next_tenth_us(&view, now);
+        view.remaining_ms[view.active_player] = clock_view_remaining_ms(&view, now);
+        wait = (next == CLOCK_NO_DEADLINE) ? portMAX_DELAY : pdMS_TO_TICKS((next - now + 999) / 1000) + 1;
+
+        bsp_display_lock(0);
+        power_display_update(view.state != Playing);
+        disp_update(&view);
+        if (press_us != traced_press_us) {
+            flush_press_us = press_us;              // Recorded when LVGL has drawn the change
+            traced_press_us = press_us;
         }
+        bsp_display_unlock();
     }
 }
 
-void refresh_display()
+/* LVGL monitor callback, called from the LVGL task with the display lock held after a refresh
+   has been rendered and flushed */
+static void display_flushed(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t px)
 {
-    while(1) {
-        vTaskSuspend( NULL );   // Task suspends itself, Waits until resuming
-        disp_set_clock1(set_time, player1_time);
-        disp_set_clock2(set_time, player2_time);
+    static bool first_frame = true;
+    if (first_frame) {
+        boot_mark("first frame");
+        first_frame = false;
     }
+    if (flush_press_us != 0) {
+        latency_record(LatencyDisplay, flush_press_us, esp_timer_get_time());
+        flush_press_us = 0;
+    }
+    lcd_refreshed(time_ms, px);
+    power_display_flushed();
 }
 
 
+/* Asset mapping and codec init, runs in parallel with the display start */
+static void audio_init_task(void *arg)
+{
+    TaskHandle_t main_task = arg;
+
+    ESP_ERROR_CHECK(assets_init());
+    boot_mark("assets");
+    ESP_ERROR_CHECK(audio_init());
+    boot_mark("audio");
+
+    xTaskNotifyGive(main_task);
+    vTaskDelete(NULL);
+}
+
 void app_main(void)
 {
+    boot_mark("app_main");
+
     /* Init board peripherals */
+    ESP_ERROR_CHECK(power_init());
     bsp_i2c_init(); // Used by ES8311 driver
-    ESP_ERROR_CHECK(spiffs_init());
-
-    /* Configure RGB LED */
-    const led_strip_config_t rgb_config = {
-        .strip_gpio_num = BSP_LEDSTRIP_IO,
-        .max_leds = 1,
-    };
-    const led_strip_rmt_config_t rmt_config = {0};
-    led_strip_new_rmt_device(&rgb_config, &rmt_config, &rgb_led);
-    assert(rgb_led != NULL);
-    ESP_ERROR_CHECK(led_strip_clear(rgb_led));
+    boot_mark("i2c");
+
+    /* Codec init waits on I2C transfers, LCD init on panel reset delays, overlap them */
+    xTaskCreate(audio_init_task, "audio init", 4096, xTaskGetCurrentTaskHandle(), 2, NULL);
+
+    ESP_ERROR_CHECK(indicator_init());
 
     /* Needed from random RGB LED color generation */
     time_t t;
     srand((unsigned) time(&t));
 
-    /* Create FreeRTOS tasks and queues */
-    audio_button_q = xQueueCreate(10, sizeof(uint8_t));
-    assert (audio_button_q != NULL);
-
-    xTaskCreate(clock_tick, "clock_tick", 4096, NULL, 1, NULL);
-    xTaskCreate(refresh_display, "refresh display", 4096, NULL, 7, &refresh_diaplay_handle);
-    xTaskCreate(play_audio, "play_audio", 4096, NULL, 7, &play_audio_handle);
-    xTaskCreate(btn_actions, "btn_actions", 4096, NULL, 6, NULL);
-
-    /* Init audio buttons */
-    for (int i = 0; i < BSP_BUTTON_NUM; i++) {
-        audio_button[i] = iot_button_create(&bsp_button_config[i]);
-        assert(audio_button[i] != NULL);
-        ESP_ERROR_CHECK(iot_button_register_cb(audio_button[i], BUTTON_PRESS_DOWN, btn_handler, NULL));
-    }
+    /* Defaults are drawn first, a saved game replaces them once NVS is read */
+    clock_init(&chess_clock, 60 * 1000, 10 * 1000);     // 60 s starting time, 10 s +/- step
+    clock_get_view(&chess_clock, 0, &clock_view);
 
     lv_disp_t *disp;
-    disp = bsp_display_start(); // Start LVGL and LCD driver
-    bsp_display_rotate(disp, LV_DISP_ROT_90);
+    disp = lcd_start();  // Start LVGL and LCD driver, landscape
+    bsp_display_lock(0);
+    disp->driver->monitor_cb = display_flushed;
+    bsp_display_unlock();
+    boot_mark("lcd");
     disp_init();         // Create LVGL screen and widgets
+    boot_mark("ui");
+
+    /* Renderer runs below the event loop, so a redraw never delays button handling */
+    APP_TASK_CREATE(refresh_display, "refresh display", 4096, NULL, 5, &refresh_diaplay_handle);
+    xTaskNotifyGive(refresh_diaplay_handle);    // Draw initial clock
+
+    /* Clock state, continued from the journal after a reset */
+    clock_view_t saved;
+    if (journal_init(&saved)) {
+        clock_restore(&chess_clock, &saved);
+        clock_get_view(&chess_clock, 0, &saved);
+        taskENTER_CRITICAL(&clock_view_lock);
+        clock_view = saved;
+        taskEXIT_CRITICAL(&clock_view_lock);
+        xTaskNotifyGive(refresh_diaplay_handle);    // Draw restored clock
+    }
+    ESP_ERROR_CHECK(calib_init());                      // Timebase correction, NVS is up
+    ESP_ERROR_CHECK(journal_start());
+    boot_mark("journal");
+    ESP_ERROR_CHECK(gamelog_init());
+    boot_mark("gamelog");
+
+    /* The event loop owns the clock from here on, it needs the journal and the move log */
+    APP_TASK_CREATE(clock_loop, "clock_loop", 4096, NULL, 6, &clock_loop_handle);
+
+    /* Start sampling buttons */
+    ESP_ERROR_CHECK(input_init(clock_loop_handle));
+    power_clock_running(false);
+    boot_mark("input");
+
+    ESP_ERROR_CHECK(console_init());
+
+    /* Clock is usable already, sounds are played once audio init is done */
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    boot_mark("init done");
+    boot_print();
+    heap_guard_arm();   // Init done, from now on nothing should touch the heap
 }
@@ -0,0 +1,128 @@
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "esp_lvgl_port.h"
+
+#include "input.h"
+#include "power.h"
+
+static const char *TAG = "power";
+
+/* Running time accounting, updated by the clock task only */
+static bool clock_running;
+static bool clock_reported;         // power_clock_running() called at least once
+static int64_t running_since;       // 0 when not running
+static int64_t running_total;
+
+#if CONFIG_CHESS_POWER_SAVE
+static esp_pm_lock_handle_t running_lock;
+static bool display_stop_pending;   // Guarded by the display lock
+static volatile uint32_t light_sleeps;
+static volatile int64_t light_sleep_total;
+
+static esp_err_t IRAM_ATTR light_sleep_exit(int64_t sleep_time_us, void *arg)
+{
+    light_sleeps++;
+    light_sleep_total += sleep_time_us;
+    return ESP_OK;
+}
+#endif
+
+esp_err_t power_init(void)
+{
+#if CONFIG_CHESS_POWER_SAVE
+    const esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = 80,
+        .light_sleep_enable = true,
+    };
+    ESP_RETURN_ON_ERROR(esp_pm_configure(&pm_config), TAG, "PM configure failed");
+    ESP_RETURN_ON_ERROR(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "clock_running", &running_lock), TAG, "PM lock failed");
+
+    esp_pm_sleep_cbs_register_config_t cbs = {
+        .exit_cb = light_sleep_exit,
+    };
+    ESP_RETURN_ON_ERROR(esp_pm_light_sleep_register_cbs(&cbs), TAG, "Sleep callback failed");
+    ESP_LOGI(TAG, "Power save: %d..%d MHz, light sleep", pm_config.min_freq_mhz, pm_config.max_freq_mhz);
+#endif
+    return ESP_OK;
+}
+
+void power_clock_running(bool running)
+{
+    if (clock_reported && running == clock_running) {
+        return;
+    }
+    bool was_running = clock_running;
+    clock_running = running;
+    clock_reported = true;
+
+    int64_t now = esp_timer_get_time();
+    if (running) {
+        running_since = now;
+    }
+    else if (was_running) {
+        running_total += now - running_since;
+        running_since = 0;
+    }
+
+#if CONFIG_CHESS_POWER_SAVE
+    /* Presses only need the 1 ms timestamp resolution while a clock is running */
+    if (running) {
+        esp_pm_lock_acquire(running_lock);
+        input_set_sample_period(INPUT_SAMPLE_PERIOD_US);
+    }
+    else {
+        input_set_sample_period(POWER_IDLE_SAMPLE_PERIOD_US);
+        if (was_running) {
+            esp_pm_lock_release(running_lock);
+        }
+    }
+#endif
+}
+
+void power_display_update(bool face_static)
+{
+#if CONFIG_CHESS_POWER_SAVE
+    lvgl_port_resume();
+    display_stop_pending = face_static;
+#endif
+}
+
+void power_display_flushed(void)
+{
+#if CONFIG_CHESS_POWER_SAVE
+    /* Face is drawn, the LVGL tick timer would only keep waking the chip up */
+    if (display_stop_pending) {
+        display_stop_pending = false;
+        lvgl_port_stop();
+    }
+#endif
+}
+
+void power_get_stats(power_stats_t *stats)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t since = running_since;
+
+    stats->uptime_us = now;
+    stats->running_us = running_total + (since ? now - since : 0);
+#if CONFIG_CHESS_POWER_SAVE
+    stats->light_sleep_us = light_sleep_total;
+    stats->light_sleeps = light_sleeps;
+#else
+    stats->light_sleep_us = 0;
+    stats->light_sleeps = 0;
+#endif
+
+    int64_t idle_us = stats->uptime_us - stats->running_us - stats->light_sleep_us;
+#if CONFIG_CHESS_POWER_SAVE
+    uint32_t idle_ua = POWER_IDLE_UA;
+#else
+    uint32_t idle_ua = POWER_ACTIVE_UA;     // CPU stays at max frequency
+#endif
+    stats->average_ua = (uint32_t)((stats->running_us * POWER_ACTIVE_UA + idle_us * idle_ua +
+                                    stats->light_sleep_us * POWER_LIGHT_SLEEP_UA) / (now ? now : 1));
+}
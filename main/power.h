@@ -0,0 +1,63 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * Power management
+ *
+ * With CONFIG_CHESS_POWER_SAVE the CPU runs at full speed only while a clock is running.
+ * With a static clock face the CPU frequency is scaled down, the LVGL tick is stopped once
+ * the face is drawn, buttons are sampled slower and the chip enters light sleep whenever
+ * FreeRTOS is idle. Without the option only the time accounting is done.
+ *
+ * Light sleep needs CONFIG_FREERTOS_IDLE_TIME_BEFORE_SLEEP ticks (30 ms) without a task or
+ * esp_timer wake-up. The idle button sampler wakes the chip every 50 ms, so sleep is only
+ * possible between its samples and only if nothing else wakes up in between; the 'power'
+ * console command reports the time actually slept. The ADC button ladder cannot wake the
+ * chip, a press is seen with the next sample.
+ */
+
+#define POWER_IDLE_SAMPLE_PERIOD_US     (50 * 1000)     // Button sampling with no clock running and no button pressed
+
+/* Typical ESP32-S2 SoC currents used for the budget estimate, board loads are not included */
+#define POWER_ACTIVE_UA         (28000)     // CPU at max frequency
+#define POWER_IDLE_UA           (14000)     // CPU at 80 MHz, mostly waiting
+#define POWER_LIGHT_SLEEP_UA    (750)
+
+typedef struct {
+    int64_t uptime_us;
+    int64_t running_us;         // Clock running, CPU locked at max frequency
+    int64_t light_sleep_us;
+    uint32_t light_sleeps;      // Light sleep entries, each ends with a wake-up
+    uint32_t average_ua;        // Estimated average SoC current
+} power_stats_t;
+
+/**
+ * @brief Configure frequency scaling and light sleep
+ */
+esp_err_t power_init(void);
+
+/**
+ * @brief Clock started or stopped running, call from the clock task
+ *
+ * Must be called once after input_init() to set the initial mode.
+ */
+void power_clock_running(bool running);
+
+/**
+ * @brief Display is about to change, call with the display lock held
+ *
+ * @param face_static Nothing will change on the display until the next call
+ */
+void power_display_update(bool face_static);
+
+/**
+ * @brief LVGL finished a refresh, call from the LVGL monitor callback
+ */
+void power_display_flushed(void);
+
+/**
+ * @brief Get time spent in each mode and the estimated current
+ */
+void power_get_stats(power_stats_t *stats);
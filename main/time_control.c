@@ -0,0 +1,19 @@
+#include "time_control.h"
+
+#define MIN(m)  ((m) * 60 * 1000)
+#define SEC(s)  ((s) * 1000)
+
+const time_control_t time_controls[] = {
+    { "Sudden death", 1, { { 0, MIN(1), 0, BonusNone } } },
+    { "Blitz 3+2", 1, { { 0, MIN(3), SEC(2), BonusFischer } } },
+    { "Blitz 5 d3", 1, { { 0, MIN(5), SEC(3), BonusDelay } } },
+    { "Blitz 5 b3", 1, { { 0, MIN(5), SEC(3), BonusBronstein } } },
+    { "Rapid 15+10", 1, { { 0, MIN(15), SEC(10), BonusFischer } } },
+    { "Classic 90+30", 1, { { 0, MIN(90), SEC(30), BonusFischer } } },
+    { "40/90, 30 +30", 2, {
+        { 40, MIN(90), SEC(30), BonusFischer },
+        { 0, MIN(30), SEC(30), BonusFischer },
+    } },
+};
+
+const unsigned int time_controls_num = sizeof(time_controls) / sizeof(time_controls[0]);
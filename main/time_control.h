@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+/**
+ * Time controls
+ *
+ * A time control is a static table of up to TC_PERIODS_MAX periods. Each period adds its time
+ * when it starts, lasts a number of moves (or the rest of the game) and has one kind of
+ * per-move bonus. The clock core only indexes into the table when a turn starts or ends,
+ * so every control costs the same on the move path.
+ */
+
+#define TC_PERIODS_MAX  (2)
+
+typedef enum {
+    BonusNone,
+    BonusFischer,       // Bonus added after every move
+    BonusBronstein,     // Time used for the move given back after it, up to the bonus
+    BonusDelay,         // Clock starts counting down only after the bonus (US delay)
+} tc_bonus_t;
+
+typedef struct {
+    uint16_t moves;         // Moves of each player in this period, 0 for the rest of the game
+    uint32_t time_ms;       // Time added when the period starts
+    uint32_t bonus_ms;
+    tc_bonus_t bonus;
+} tc_period_t;
+
+typedef struct {
+    const char *name;
+    uint8_t periods_num;
+    tc_period_t periods[TC_PERIODS_MAX];
+} time_control_t;
+
+/* Presets, the first one is sudden death with the starting time set by +/- */
+extern const time_control_t time_controls[];
+extern const unsigned int time_controls_num;
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include "timebase.h"
+
+/* d * ppb / 1e9 without overflow for any d a game can reach, 32-bit targets have no __int128 */
+static int64_t scale_ppb(int64_t d, int32_t ppb)
+{
+    return d / 1000000 * ppb / 1000 + d % 1000000 * ppb / 1000000000;
+}
+
+static int32_t clamp_ppb(int32_t ppb)
+{
+    if (ppb > TIMEBASE_PPB_MAX) {
+        return TIMEBASE_PPB_MAX;
+    }
+    if (ppb < -TIMEBASE_PPB_MAX) {
+        return -TIMEBASE_PPB_MAX;
+    }
+    return ppb;
+}
+
+void timebase_init(timebase_t *tb, int64_t raw_us, int32_t ppb)
+{
+    tb->raw_us = raw_us;
+    tb->corrected_us = raw_us;
+    tb->ppb = clamp_ppb(ppb);
+}
+
+void timebase_set_ppb(timebase_t *tb, int64_t raw_us, int32_t ppb)
+{
+    tb->corrected_us = timebase_correct(tb, raw_us);
+    tb->raw_us = raw_us;
+    tb->ppb = clamp_ppb(ppb);
+}
+
+int64_t timebase_correct(const timebase_t *tb, int64_t raw_us)
+{
+    int64_t d = raw_us - tb->raw_us;
+    return tb->corrected_us + d + scale_ppb(d, tb->ppb);
+}
+
+void drift_start(drift_t *d, int64_t period_us)
+{
+    *d = (drift_t) {
+        .period_us = period_us,
+    };
+}
+
+void drift_edge(drift_t *d, int64_t time_us)
+{
+    if (d->first_us == 0) {
+        d->first_us = time_us;
+        d->last_us = time_us;
+        return;
+    }
+
+    /* Nearest whole number of periods, more than one when edges were missed */
+    int64_t dt = time_us - d->last_us;
+    int64_t n = (dt + d->period_us / 2) / d->period_us;
+    int64_t deviation = dt - n * d->period_us;
+    if (n == 0 || llabs(deviation) > d->period_us / DRIFT_TOLERANCE_DIV) {
+        d->rejected++;
+        return;
+    }
+    d->intervals += n;
+    d->last_us = time_us;
+    if (llabs(deviation) > d->jitter_us) {
+        d->jitter_us = llabs(deviation);
+    }
+}
+
+bool drift_ppb(const drift_t *d, int32_t *ppb)
+{
+    if (d->intervals < DRIFT_MIN_INTERVALS) {
+        return false;
+    }
+    /* Reference time over raw time, the edge latency cancels out between first and last edge */
+    int64_t raw = d->last_us - d->first_us;
+    int64_t ref = (int64_t)d->intervals * d->period_us;
+    int64_t p = (ref - raw) * 1000000000 / raw;
+    if (p > TIMEBASE_PPB_MAX || p < -TIMEBASE_PPB_MAX) {
+        p = (p > 0) ? TIMEBASE_PPB_MAX : -TIMEBASE_PPB_MAX;
+    }
+    *ppb = (int32_t)p;
+    return true;
+}
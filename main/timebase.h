@@ -0,0 +1,71 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Corrected timebase and drift estimator
+ *
+ * The clock core runs on esp_timer timestamps, i.e. on the 40 MHz crystal, and inherits its
+ * frequency error: 20 ppm are 0.14 s over a 2 h game. A timebase maps raw timestamps to
+ * corrected ones with a rate correction in parts per billion. Changing the correction re-anchors
+ * the mapping, so corrected time stays continuous and monotonic.
+ *
+ * The drift estimator measures the raw timer against reference edges of a known period (e.g. a
+ * 1 PPS signal). Missed edges are bridged, edges off the period grid by more than
+ * DRIFT_TOLERANCE_DIV of the period are rejected as glitches.
+ *
+ * The module has no dependency on FreeRTOS.
+ */
+
+#define TIMEBASE_PPB_MAX        (500 * 1000)    // Largest accepted correction, 500 ppm
+#define DRIFT_TOLERANCE_DIV     (100)           // Edges may deviate from the grid by 1 % of the period
+#define DRIFT_MIN_INTERVALS     (10)            // Reference periods needed for an estimate
+
+typedef struct {
+    int64_t raw_us;         // Anchor on the raw timer
+    int64_t corrected_us;   // Corrected time at the anchor
+    int32_t ppb;            // Rate correction, positive when the raw timer runs slow
+} timebase_t;
+
+typedef struct {
+    int64_t period_us;      // Nominal reference period
+    int64_t first_us;       // Raw timestamp of the first accepted edge, 0 before it
+    int64_t last_us;        // Raw timestamp of the last accepted edge
+    uint32_t intervals;     // Reference periods between first and last edge
+    uint32_t rejected;      // Edges off the period grid
+    int32_t jitter_us;      // Largest deviation of an accepted edge from the grid
+} drift_t;
+
+/**
+ * @brief Start a timebase with corrected time equal to raw time at raw_us
+ */
+void timebase_init(timebase_t *tb, int64_t raw_us, int32_t ppb);
+
+/**
+ * @brief Change the correction from raw_us on, clamped to +-TIMEBASE_PPB_MAX
+ */
+void timebase_set_ppb(timebase_t *tb, int64_t raw_us, int32_t ppb);
+
+/**
+ * @brief Convert a raw timestamp to corrected time
+ *
+ * Valid for raw_us before the anchor too, e.g. for an input that waited in a queue.
+ */
+int64_t timebase_correct(const timebase_t *tb, int64_t raw_us);
+
+/**
+ * @brief Start a drift measurement against edges every period_us
+ */
+void drift_start(drift_t *d, int64_t period_us);
+
+/**
+ * @brief Add a reference edge seen at raw time time_us
+ */
+void drift_edge(drift_t *d, int64_t time_us);
+
+/**
+ * @brief Rate correction that makes the raw timer match the reference
+ *
+ * @return false with fewer than DRIFT_MIN_INTERVALS reference periods
+ */
+bool drift_ppb(const drift_t *d, int32_t *ppb);
@@ -0,0 +1,351 @@
+#include <stdbool.h>
+#include <string.h>
+#include "wav_reader.h"
+
+#define PHASE_ONE               (1 << 16)
+
+static inline uint16_t rd16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t rd32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const int16_t ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t ima_index_table[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static inline int16_t adpcm_decode_nibble(int16_t *pred, int8_t *index, uint8_t nibble)
+{
+    int32_t step = ima_step_table[*index];
+    int32_t diff = step >> 3;
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 4) {
+        diff += step;
+    }
+
+    int32_t p = *pred + ((nibble & 8) ? -diff : diff);
+    *pred = (p > INT16_MAX) ? INT16_MAX : (p < INT16_MIN) ? INT16_MIN : p;
+
+    int32_t i = *index + ima_index_table[nibble & 7];
+    *index = (i < 0) ? 0 : (i > 88) ? 88 : i;
+    return *pred;
+}
+
+/* Samples in the (possibly truncated) ADPCM block at pos */
+static uint32_t adpcm_block_samples(const wav_reader_t *reader)
+{
+    uint32_t bytes = reader->data_size - reader->pos;
+    if (bytes > reader->block_align) {
+        bytes = reader->block_align;
+    }
+    if (bytes < 4u * reader->channels) {
+        return 0;
+    }
+    bytes -= 4 * reader->channels;     // Per channel header: predictor, step index, reserved
+
+    uint32_t samples = (reader->channels == 1) ? bytes * 2 : (bytes / 8) * 8;
+    if (samples + 1 > reader->samples_per_block) {
+        samples = reader->samples_per_block - 1;
+    }
+    return samples + 1;
+}
+
+/* Decode up to WAV_BLOCK_FRAMES samples of IMA-ADPCM, keeping decoder state between calls.
+   Mono nibbles follow the headers low nibble first, stereo alternates 4 bytes (8 samples) of
+   each channel. The last block may end in a padding nibble, the 'fact' length excludes it. */
+static bool decode_adpcm(wav_reader_t *reader)
+{
+    int16_t *dst = reader->block;
+    uint32_t frames = 0;
+    const uint32_t channels = reader->channels;
+    uint32_t limit = WAV_BLOCK_FRAMES;
+    if (reader->adpcm_frames != 0 && reader->adpcm_frames - reader->adpcm_decoded < limit) {
+        limit = reader->adpcm_frames - reader->adpcm_decoded;
+    }
+
+    while (frames < limit) {
+        uint32_t block_samples = adpcm_block_samples(reader);
+        if (reader->adpcm_sample >= block_samples) {
+            if (block_samples == 0) {
+                break;
+            }
+            reader->pos += (reader->data_size - reader->pos < reader->block_align) ? reader->data_size - reader->pos : reader->block_align;
+            reader->adpcm_sample = 0;
+            continue;
+        }
+
+        const uint8_t *p = reader->data + reader->pos;
+        if (reader->adpcm_sample == 0) {
+            /* Block header carries the first sample */
+            int32_t sum = 0;
+            for (uint32_t c = 0; c < channels; c++) {
+                reader->adpcm_pred[c] = (int16_t)rd16(p + 4 * c);
+                reader->adpcm_index[c] = (p[4 * c + 2] > 88) ? 88 : p[4 * c + 2];
+                sum += reader->adpcm_pred[c];
+            }
+            dst[frames++] = (int16_t)(sum / (int32_t)channels);
+            reader->adpcm_sample = 1;
+            continue;
+        }
+
+        uint32_t count = block_samples - reader->adpcm_sample;
+        if (count > limit - frames) {
+            count = limit - frames;
+        }
+
+        if (channels == 1) {
+            for (uint32_t j = reader->adpcm_sample - 1, end = j + count; j < end; j++) {
+                uint8_t byte = p[4 + j / 2];
+                uint8_t nibble = (j & 1) ? (byte >> 4) : (byte & 0x0F);
+                dst[frames++] = adpcm_decode_nibble(&reader->adpcm_pred[0], &reader->adpcm_index[0], nibble);
+            }
+        }
+        else {
+            for (uint32_t j = reader->adpcm_sample - 1, end = j + count; j < end; j++) {
+                uint32_t offset = 8 + (j / 8) * 8 + (j % 8) / 2;
+                uint32_t shift = (j & 1) ? 4 : 0;
+                int32_t l = adpcm_decode_nibble(&reader->adpcm_pred[0], &reader->adpcm_index[0], (p[offset] >> shift) & 0x0F);
+                int32_t r = adpcm_decode_nibble(&reader->adpcm_pred[1], &reader->adpcm_index[1], (p[offset + 4] >> shift) & 0x0F);
+                dst[frames++] = (int16_t)((l + r) >> 1);
+            }
+        }
+        reader->adpcm_sample += count;
+    }
+
+    reader->adpcm_decoded += frames;
+    reader->block_len = frames;
+    reader->block_pos = 0;
+    return frames > 0;
+}
+
+/* Decode next block of input frames to 16-bit mono. Returns false at the end of data. */
+static bool decode_block(wav_reader_t *reader)
+{
+    if (reader->format == WAVE_FORMAT_IMA_ADPCM) {
+        return decode_adpcm(reader);
+    }
+
+    uint32_t frames = (reader->data_size - reader->pos) / reader->block_align;
+    if (frames > WAV_BLOCK_FRAMES) {
+        frames = WAV_BLOCK_FRAMES;
+    }
+    if (frames == 0) {
+        return false;
+    }
+
+    const uint8_t *p = reader->data + reader->pos;
+    int16_t *dst = reader->block;
+
+    /* One tight loop per format, down-mixing stereo by averaging */
+    switch ((reader->bits_per_sample << 2) | reader->channels) {
+        case (8 << 2) | 1:
+            for (uint32_t i = 0; i < frames; i++) {
+                dst[i] = (int16_t)((p[i] - 128) << 8);
+            }
+            break;
+        case (8 << 2) | 2:
+            for (uint32_t i = 0; i < frames; i++, p += 2) {
+                dst[i] = (int16_t)((p[0] + p[1] - 256) << 7);
+            }
+            break;
+        case (16 << 2) | 1:
+            memcpy(dst, p, frames * sizeof(int16_t));
+            break;
+        case (16 << 2) | 2:
+            for (uint32_t i = 0; i < frames; i++, p += 4) {
+                dst[i] = (int16_t)(((int16_t)rd16(p) + (int16_t)rd16(p + 2)) >> 1);
+            }
+            break;
+        case (24 << 2) | 1:
+            for (uint32_t i = 0; i < frames; i++, p += 3) {
+                dst[i] = (int16_t)rd16(p + 1);
+            }
+            break;
+        case (24 << 2) | 2:
+            for (uint32_t i = 0; i < frames; i++, p += 6) {
+                dst[i] = (int16_t)(((int16_t)rd16(p + 1) + (int16_t)rd16(p + 4)) >> 1);
+            }
+            break;
+        default:
+            return false;
+    }
+
+    reader->pos += frames * reader->block_align;
+    reader->block_len = frames;
+    reader->block_pos = 0;
+    return true;
+}
+
+static void set_rates(wav_reader_t *reader, uint32_t sample_rate, uint32_t out_rate)
+{
+    reader->sample_rate = sample_rate;
+    reader->step = (uint32_t)(((uint64_t)sample_rate << 16) / out_rate);
+}
+
+esp_err_t wav_reader_open(wav_reader_t *reader, const void *wav, size_t size, uint32_t out_rate)
+{
+    const uint8_t *p = wav;
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0 || out_rate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t riff_end = 8 + (size_t)rd32(p + 4);
+    if (riff_end > size) {
+        riff_end = size;    // Tolerate truncated files
+    }
+
+    /* Walk chunks, skipping everything except 'fmt ' and 'data' */
+    bool have_fmt = false;
+    uint16_t format = 0;
+    const uint8_t *data = NULL;
+    uint32_t data_size = 0;
+    uint32_t fact_frames = 0;
+    for (size_t off = 12; off + 8 <= riff_end; ) {
+        const uint8_t *chunk = p + off;
+        uint32_t chunk_size = rd32(chunk + 4);
+        size_t avail = riff_end - off - 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || chunk_size > avail) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            const uint8_t *fmt = chunk + 8;
+            format = rd16(fmt);
+            reader->channels = rd16(fmt + 2);
+            reader->sample_rate = rd32(fmt + 4);
+            reader->block_align = rd16(fmt + 12);
+            reader->bits_per_sample = rd16(fmt + 14);
+            reader->samples_per_block = (chunk_size >= 20) ? rd16(fmt + 18) : 0;
+            if (format == WAVE_FORMAT_EXTENSIBLE && chunk_size >= 40) {
+                format = rd16(fmt + 24);    // First two bytes of the SubFormat GUID
+            }
+            have_fmt = true;
+        }
+        else if (memcmp(chunk, "fact", 4) == 0 && chunk_size >= 4 && chunk_size <= avail) {
+            fact_frames = rd32(chunk + 8);
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            data = chunk + 8;
+            data_size = (chunk_size > avail) ? avail : chunk_size;
+        }
+
+        if (chunk_size > riff_end - off) {
+            break;
+        }
+        off += 8 + chunk_size + (chunk_size & 1);   // Chunks are word aligned
+    }
+
+    if (!have_fmt || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (reader->channels < 1 || reader->channels > 2 || reader->sample_rate == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (format == WAVE_FORMAT_PCM) {
+        if ((reader->bits_per_sample != 8 && reader->bits_per_sample != 16 && reader->bits_per_sample != 24) ||
+            reader->block_align != reader->channels * reader->bits_per_sample / 8) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        data_size -= data_size % reader->block_align;
+    }
+    else if (format == WAVE_FORMAT_IMA_ADPCM) {
+        if (reader->bits_per_sample != 4 || reader->block_align <= 4 * reader->channels) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        /* cbSize and wSamplesPerBlock are optional, samples_per_block can be derived */
+        uint32_t max_samples = (reader->block_align - 4 * reader->channels) * 2 / reader->channels + 1;
+        if (reader->samples_per_block == 0 || reader->samples_per_block > max_samples) {
+            reader->samples_per_block = max_samples;
+        }
+        reader->adpcm_frames = fact_frames;
+    }
+    else {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    reader->format = format;
+    reader->data = data;
+    reader->data_size = data_size;
+    set_rates(reader, reader->sample_rate, out_rate);
+    wav_reader_rewind(reader);
+    return ESP_OK;
+}
+
+void wav_reader_open_pcm(wav_reader_t *reader, const int16_t *pcm, size_t frames, uint32_t sample_rate, uint32_t out_rate)
+{
+    reader->data = (const uint8_t *)pcm;
+    reader->data_size = frames * sizeof(int16_t);
+    reader->format = WAVE_FORMAT_PCM;
+    reader->channels = 1;
+    reader->bits_per_sample = 16;
+    reader->block_align = sizeof(int16_t);
+    set_rates(reader, sample_rate, out_rate);
+    wav_reader_rewind(reader);
+}
+
+void wav_reader_rewind(wav_reader_t *reader)
+{
+    reader->pos = 0;
+    reader->adpcm_sample = 0;
+    reader->adpcm_decoded = 0;
+    reader->block_len = 0;
+    reader->block_pos = 0;
+    reader->prev = 0;
+    reader->cur = 0;
+    reader->phase = 2 * PHASE_ONE;     // First output loads two input samples
+}
+
+size_t wav_reader_read(wav_reader_t *reader, int16_t *out, size_t frames)
+{
+    size_t n = 0;
+
+    /* Same rate: copy decoded blocks */
+    if (reader->step == PHASE_ONE) {
+        while (n < frames) {
+            if (reader->block_pos == reader->block_len && !decode_block(reader)) {
+                break;
+            }
+            size_t count = reader->block_len - reader->block_pos;
+            if (count > frames - n) {
+                count = frames - n;
+            }
+            memcpy(out + n, reader->block + reader->block_pos, count * sizeof(int16_t));
+            reader->block_pos += count;
+            n += count;
+        }
+        return n;
+    }
+
+    /* Linear interpolation between prev and cur, phase is Q16 and is used as Q15 so that the
+       product of a 17-bit difference fits 32 bits */
+    while (n < frames) {
+        while (reader->phase >= PHASE_ONE) {
+            if (reader->block_pos == reader->block_len && !decode_block(reader)) {
+                return n;
+            }
+            reader->prev = reader->cur;
+            reader->cur = reader->block[reader->block_pos++];
+            reader->phase -= PHASE_ONE;
+        }
+        int32_t diff = reader->cur - reader->prev;
+        out[n++] = (int16_t)(reader->prev + ((diff * (int32_t)(reader->phase >> 1)) >> 15));
+        reader->phase += reader->step;
+    }
+    return n;
+}
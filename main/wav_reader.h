@@ -0,0 +1,74 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * Streaming RIFF/WAV reader
+ *
+ * Walks the RIFF chunks of a WAV file held in memory (mapped flash or PSRAM) and converts
+ * its samples block by block to 16-bit mono at the requested output rate. Supports 8/16/24-bit
+ * PCM and 4-bit IMA-ADPCM, mono/stereo and any sample rate. Stereo is down-mixed and the rate
+ * is converted with a fixed-point linear interpolator. The file is never decoded as a whole.
+ */
+
+#define WAV_BLOCK_FRAMES    (64)    // Input frames decoded at once
+
+#define WAVE_FORMAT_PCM         (0x0001)
+#define WAVE_FORMAT_IMA_ADPCM   (0x0011)
+#define WAVE_FORMAT_EXTENSIBLE  (0xFFFE)
+
+typedef struct {
+    const uint8_t *data;        // Start of the data chunk
+    uint32_t data_size;         // Size of the data chunk [bytes]
+    uint32_t pos;               // Bytes consumed from the data chunk
+    uint16_t format;            // WAVE_FORMAT_PCM or WAVE_FORMAT_IMA_ADPCM
+    uint16_t channels;
+    uint16_t bits_per_sample;
+    uint16_t block_align;       // Bytes per input frame (PCM) or per compressed block (ADPCM)
+    uint32_t sample_rate;
+
+    /* IMA-ADPCM decoder state */
+    uint16_t samples_per_block;
+    uint16_t adpcm_sample;      // Next sample within the block at pos
+    uint32_t adpcm_frames;      // Frames in the file from the 'fact' chunk, 0 if unknown
+    uint32_t adpcm_decoded;     // Frames decoded since the start
+    int16_t adpcm_pred[2];
+    int8_t adpcm_index[2];
+
+    /* Resampler state */
+    uint32_t step;              // Input frames per output frame, Q16.16
+    uint32_t phase;             // Position between prev and cur, Q16.16
+    int16_t prev;
+    int16_t cur;
+
+    /* Decoded input block, 16-bit mono */
+    int16_t block[WAV_BLOCK_FRAMES];
+    uint16_t block_len;
+    uint16_t block_pos;
+} wav_reader_t;
+
+/**
+ * @brief Parse WAV header and prepare conversion to out_rate
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for malformed files, ESP_ERR_NOT_SUPPORTED for
+ *         unsupported formats
+ */
+esp_err_t wav_reader_open(wav_reader_t *reader, const void *wav, size_t size, uint32_t out_rate);
+
+/**
+ * @brief Set up reader for raw 16-bit mono PCM
+ */
+void wav_reader_open_pcm(wav_reader_t *reader, const int16_t *pcm, size_t frames, uint32_t sample_rate, uint32_t out_rate);
+
+/**
+ * @brief Read converted 16-bit mono samples
+ *
+ * @return Frames written to out, less than 'frames' only at the end of the file
+ */
+size_t wav_reader_read(wav_reader_t *reader, int16_t *out, size_t frames);
+
+/**
+ * @brief Rewind to the first sample
+ */
+void wav_reader_rewind(wav_reader_t *reader);
@@ -0,0 +1,108 @@
+"""IMA-ADPCM encoder for WAV assets.
+
+Converts a PCM WAV (8/16/24-bit, mono or stereo) to a mono 4-bit IMA-ADPCM WAV
+(WAVE_FORMAT_IMA_ADPCM, 256 byte blocks of 505 samples), decoded by main/wav_reader.c.
+"""
+import io
+import struct
+import wave
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+WAVE_FORMAT_IMA_ADPCM = 0x0011
+BLOCK_ALIGN = 256
+SAMPLES_PER_BLOCK = (BLOCK_ALIGN - 4) * 2 + 1
+
+
+def read_pcm_mono(data):
+    """Return (sample rate, 16-bit mono samples) of a PCM WAV file."""
+    with wave.open(io.BytesIO(data)) as w:
+        channels, width, rate = w.getnchannels(), w.getsampwidth(), w.getframerate()
+        raw = w.readframes(w.getnframes())
+
+    samples = []
+    for i in range(0, len(raw) - len(raw) % (width * channels), width * channels):
+        total = 0
+        for c in range(channels):
+            s = raw[i + c * width:i + (c + 1) * width]
+            if width == 1:
+                total += (s[0] - 128) << 8
+            else:
+                total += int.from_bytes(s[-2:], 'little', signed=True)
+        samples.append(total // channels)
+    return rate, samples
+
+
+class Encoder:
+    def __init__(self):
+        self.pred = 0
+        self.index = 0
+        self.decoded = []   # Samples as a decoder reconstructs them
+
+    def nibble(self, sample):
+        step = STEP_TABLE[self.index]
+        diff = sample - self.pred
+        nibble = 0
+        if diff < 0:
+            nibble = 8
+            diff = -diff
+
+        vpdiff = step >> 3
+        mask = 4
+        while mask:
+            if diff >= step:
+                nibble |= mask
+                diff -= step
+                vpdiff += step
+            step >>= 1
+            mask >>= 1
+
+        self.pred += -vpdiff if nibble & 8 else vpdiff
+        self.pred = max(-32768, min(32767, self.pred))
+        self.index = max(0, min(88, self.index + INDEX_TABLE[nibble & 7]))
+        self.decoded.append(self.pred)
+        return nibble
+
+    def block(self, samples):
+        self.pred = samples[0]
+        self.decoded.append(self.pred)
+        out = bytearray(struct.pack('<hBB', self.pred, self.index, 0))
+        nibbles = [self.nibble(s) for s in samples[1:]]
+        if len(nibbles) % 2:
+            nibbles.append(0)
+        for i in range(0, len(nibbles), 2):
+            out.append(nibbles[i] | (nibbles[i + 1] << 4))
+        return bytes(out)
+
+
+def encode_wav(data, encoder=None):
+    """Encode PCM WAV file contents to IMA-ADPCM WAV file contents.
+
+    Pass an Encoder to read back the decoded samples.
+    """
+    rate, samples = read_pcm_mono(data)
+    encoder = encoder or Encoder()
+    blocks = b''.join(encoder.block(samples[i:i + SAMPLES_PER_BLOCK])
+                      for i in range(0, len(samples), SAMPLES_PER_BLOCK))
+
+    byte_rate = rate * BLOCK_ALIGN // SAMPLES_PER_BLOCK
+    fmt = struct.pack('<HHIIHHHH', WAVE_FORMAT_IMA_ADPCM, 1, rate, byte_rate, BLOCK_ALIGN, 4, 2, SAMPLES_PER_BLOCK)
+    chunks = (b'fmt ' + struct.pack('<I', len(fmt)) + fmt +
+              b'fact' + struct.pack('<II', 4, len(samples)) +
+              b'data' + struct.pack('<I', len(blocks)) + blocks + b'\0' * (len(blocks) & 1))
+    return b'RIFF' + struct.pack('<I', 4 + len(chunks)) + b'WAVE' + chunks
+
+
+def is_pcm_wav(data):
+    try:
+        with wave.open(io.BytesIO(data)):
+            return True
+    except (wave.Error, EOFError):
+        return False
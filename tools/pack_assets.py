@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Pack asset files into an image for the 'assets' partition.
+
+Image layout (little endian), read by main/assets.c:
+
+    header   magic "CLKA", u16 version, u16 entry count, u32 image size
+    entries  count x { char name[24] (NUL padded), u32 offset, u32 size }
+    data     files, each aligned to 4 bytes, offsets relative to image start
+
+PCM WAV files are encoded to IMA-ADPCM (4:1) with --adpcm.
+
+Usage: pack_assets.py [--adpcm] <asset dir> <output image> [partition size]
+"""
+import os
+import struct
+import sys
+
+import adpcm
+
+MAGIC = b'CLKA'
+VERSION = 1
+HEADER = struct.Struct('<4sHHI')
+ENTRY = struct.Struct('<24sII')
+NAME_LEN = 24
+ALIGN = 4
+
+
+def pack(files):
+    entries = []
+    data = bytearray()
+    offset = HEADER.size + ENTRY.size * len(files)
+    offset += -offset % ALIGN
+
+    for name, content in files:
+        encoded = name.encode()
+        if len(encoded) >= NAME_LEN:
+            raise ValueError('asset name too long: %s' % name)
+        entries.append(ENTRY.pack(encoded, offset + len(data), len(content)))
+        data += content
+        data += b'\0' * (-len(data) % ALIGN)
+
+    table = HEADER.pack(MAGIC, VERSION, len(files), 0) + b''.join(entries)
+    table += b'\0' * (-len(table) % ALIGN)
+    image = table + data
+    return HEADER.pack(MAGIC, VERSION, len(files), len(image)) + image[HEADER.size:]
+
+
+def main():
+    args = sys.argv[1:]
+    use_adpcm = '--adpcm' in args
+    args = [a for a in args if a != '--adpcm']
+    if len(args) < 2:
+        sys.exit(__doc__)
+    asset_dir, output = args[0], args[1]
+    part_size = int(args[2], 0) if len(args) > 2 else None
+
+    files = []
+    for name in sorted(os.listdir(asset_dir)):
+        path = os.path.join(asset_dir, name)
+        if os.path.isfile(path):
+            with open(path, 'rb') as f:
+                content = f.read()
+            if use_adpcm and name.lower().endswith('.wav') and adpcm.is_pcm_wav(content):
+                encoded = adpcm.encode_wav(content)
+                print('%s: %d -> %d bytes IMA-ADPCM' % (name, len(content), len(encoded)))
+                content = encoded
+            files.append((name, content))
+
+    image = pack(files)
+    if part_size is not None and len(image) > part_size:
+        sys.exit('assets image is %d bytes, partition has only %d' % (len(image), part_size))
+
+    with open(output, 'wb') as f:
+        f.write(image)
+    print('Packed %d assets, %d bytes' % (len(files), len(image)))
+
+
+if __name__ == '__main__':
+    main()